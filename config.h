@@ -39,8 +39,11 @@
 // Default settings. Used when resetting EEPROM. Change to desired name in defaults.h
 #define DEFAULTS_GENERIC
 
-// Serial baud rate
+// Serial baud rate at power-up and default of the baud rate setting ($24). Grbl switches to the
+// setting at the end of startup and upon each reset. Rates with an error above the limit for the
+// CPU clock are rejected. '$U' lists the error of the common baud rates.
 #define BAUD_RATE 9600
+// #define SERIAL_BAUD_MAX_ERROR 4.0 // Percent. Uncomment to override the default in serial.h
 
 // Default pin mappings. Grbl officially supports the Arduino Uno only. Other processor types
 // may exist from user-supplied templates or directly user-defined in pin_map.h
@@ -56,6 +59,7 @@
 #define CMD_FEED_HOLD         '!'
 #define CMD_CYCLE_START       '~'
 #define CMD_RESET             0x18 // ctrl-x
+#define CMD_JOG_CANCEL        0x85 // Decelerates a $J= jog to a stop and discards the rest. Ignored otherwise.
 
 // The temporal resolution of the acceleration management subsystem. Higher number give smoother
 // acceleration but may impact performance.
@@ -79,24 +83,31 @@
 // never reach its target. This parameter should always be greater than zero.
 #define MINIMUM_STEPS_PER_MINUTE      800 // (steps/min) - Integer value only
 
-// Time delay increments performed during a dwell. The default value is set at 50ms, which provides
-// a maximum time delay of roughly 55 minutes, more than enough for most any application. Increasing
-// this delay will increase the maximum dwell time linearly, but also reduces the responsiveness of 
-// run-time command executions, like status reports, since these are performed between each dwell 
-// time step. Also, keep in mind that the Arduino delay timer is not very accurate for long delays.
-#define DWELL_TIME_STEP               50 // Integer (1-255) (milliseconds)
+// Arc segmentation limits. Arcs are split into line segments sized by the arc tolerance setting,
+// which bounds the chord deviation from the true arc. These limits clamp the resulting segment
+// count. The maximum angle per segment sets a floor, so very small radii still get enough
+// segments to trace their shape and stay within the small angle approximation used by mc_arc.
+// The minimum segment length sets a ceiling, so the planner is never fed segments that are only
+// a few steps long. The ceiling takes precedence when both apply.
+#define ARC_MAX_ANGLE_PER_SEGMENT     0.1  // (radians)
+#define ARC_MIN_SEGMENT_LENGTH        0.01 // (mm)
+
+// Time resolution of a dwell. A G4 dwell is buffered in the planner as a block with no motion,
+// which the stepper interrupt times by counting its own events at this fixed rate. The default of
+// 1000 gives millisecond resolution, while only waking the stepper interrupt once per millisecond.
+// Since the dwell runs in the stepper, the parser keeps reading and buffering the following lines.
+#define DWELL_TICKS_PER_SECOND        1000 // Integer (steps/sec equivalent, 14-30000)
 
 // If homing is enabled, homing init lock sets Grbl into an alarm state upon power up. This forces
 // the user to perform the homing cycle (or override the locks) before doing anything else. This is
 // mainly a safety feature to remind the user to home, since position is unknown to Grbl.
 #define HOMING_INIT_LOCK // Comment to disable
 
-// The homing cycle seek and feed rates will adjust so all axes independently move at the homing
-// seek and feed rates regardless of how many axes are in motion simultaneously. If disabled, rates
-// are point-to-point rates, as done in normal operation. For example in an XY diagonal motion, the
-// diagonal motion moves at the intended rate, but the individual axes move at 70% speed. This option
-// just moves them all at 100% speed.
-#define HOMING_RATE_ADJUST // Comment to disable
+// Dual-motor gantry axis. Uncomment and set to the axis driven by two motors, such as Y on a
+// gantry router. The second motor steps with its axis, but has its own step pin and limit switch,
+// defined by SLAVE_STEP_BIT and SLAVE_LIMIT_BIT in the pin map. When homing, each motor stops on
+// its own switch, which squares the gantry. Requires a pin map with free pins, i.e. the Mega 2560.
+// #define GANTRY_SLAVE_AXIS Y_AXIS
 
 // Define the homing cycle search patterns with bitmasks. The homing cycle first performs a search
 // to engage the limit switches. HOMING_SEARCH_CYCLE_x are executed in order starting with suffix 0 
@@ -105,7 +116,9 @@
 // Search cycle 0 is required, but cycles 1 and 2 are both optional and may be commented to disable.
 // After the search cycle, homing then performs a series of locating about the limit switches to hone
 // in on machine zero, followed by a pull-off maneuver. HOMING_LOCATE_CYCLE governs these final moves,
-// and this mask must contain all axes in the search.
+// and this mask must contain all axes in the search. The axes of a cycle move in parallel, each at
+// its own homing rate ($25-$30), and each stops independently on its own switch. So all axes may
+// also search in a single cycle, if the workspace allows.
 // NOTE: Later versions may have this installed in settings.
 #define HOMING_SEARCH_CYCLE_0 (1<<Z_AXIS)                // First move Z to clear workspace.
 #define HOMING_SEARCH_CYCLE_1 ((1<<X_AXIS)|(1<<Y_AXIS))  // Then move X,Y at the same time.
@@ -117,21 +130,63 @@
 // greater.
 #define N_HOMING_LOCATE_CYCLE 2 // Integer (1-128)
 
+// Maximum travel of the homing motions. Each search motion moves each axis at most its max travel
+// setting ($35-$37) times the search scalar towards its switch, so the switch is found from anywhere
+// on the axis, however long. Each locate motion moves at most the locate travel. Homing fails with
+// an alarm, if an axis does not reach its switch state within it.
+#define HOMING_SEARCH_SCALAR 1.5    // Multiplier of max travel. Must be greater than 1.0.
+#define HOMING_LOCATE_TRAVEL 10.0   // mm
+
+// Limit pin sampling period of the debounce timer (Timer0). The debounce time setting ($21) sets
+// how long all limit pins must read the same for a switch state to be confirmed, rounded up to
+// whole periods. Hard limits then trip within the debounce time, while shorter spurious edges on
+// long cables are filtered out. While homing, each axis stops on its confirmed switch state.
+#define LIMIT_DEBOUNCE_PERIOD 50 // usec (1-127 at 16MHz)
+
+// Quick re-homing from a parked position saved by '$S', or when the steppers go idle holding their
+// position (step idle delay 255). Each axis moves at the default seek rate to this distance short
+// of where its switch is expected, then searches twice this distance at the homing seek rate. If a
+// switch is hit early or not found, the full homing search runs instead.
+#define HOMING_QUICK_WINDOW 5.0 // mm
+
 // Number of blocks Grbl executes upon startup. These blocks are stored in EEPROM, where the size
 // and addresses are defined in settings.h. With the current settings, up to 5 startup blocks may
 // be stored and executed in order. These startup blocks would typically be used to set the g-code
 // parser state depending on user preferences.
 #define N_STARTUP_LINE 2 // Integer (1-5)
 
+// The fields of the real-time status report are selected at runtime by the status report mask
+// setting. With the work offset field selected, the work coordinate offset is sent only when it
+// changes and additionally once every this many reports, so a host that missed it catches up.
+#define REPORT_WCO_REFRESH_COUNT 10 // Integer (1-255)
+
+// Appends the number of free planner blocks and free serial receive buffer bytes to each 'ok'
+// response, as 'ok Buf:15,RX:120', so a streaming interface knows exactly how much Grbl can accept
+// without polling. The same data is available in the status report with the buffer state field.
+// Disabled by default, since it changes a response that many interfaces match exactly.
+// #define REPORT_OK_BUFFER_STATE // Uncomment to enable
+
 // ---------------------------------------------------------------------------------------
 // FOR ADVANCED USERS ONLY: 
 
+// RAM budget. The Atmega328p has 2KB of SRAM for all static variables and the stack. The buffer
+// defaults below are sized for the 328p and leave about 230 bytes for the stack. The Mega 2560
+// raises them in pin_map.h. After linking, 'make' checks the static RAM use against the SRAM less
+// STACK_RESERVE, and the flash use against the bootloader limit, and fails if either is exceeded.
+// Any increase here comes out of the stack.
+
 // The number of linear motions in the planner buffer to be planned at any give time. The vast
 // majority of RAM that Grbl uses is based on this buffer size. Only increase if there is extra 
 // available RAM, like when re-compiling for a Teensy or Sanguino. Or decrease if the Arduino
 // begins to crash due to the lack of available RAM or if the CPU is having trouble keeping
 // up with planning new incoming motions as they are executed. 
-// #define BLOCK_BUFFER_SIZE 18  // Uncomment to override default in planner.h.
+// #define BLOCK_BUFFER_SIZE 14  // Uncomment to override default in planner.h.
+
+// The number of parsed line motions held between the g-code parser and a full planner buffer. While
+// the planner is full, the parser keeps reading, converting and acknowledging up to this many motion
+// lines ahead instead of stalling, so the next block is ready the moment a planner slot opens. Each
+// entry costs 22 bytes of RAM.
+// #define MOTION_QUEUE_SIZE 2  // Uncomment to override default in motion_control.h.
 
 // Line buffer size from the serial input stream to be executed. Also, governs the size of 
 // each of the startup blocks, as they are each stored as a string of this size. Make sure
@@ -149,8 +204,13 @@
 // increase the receive buffer if a deeper receive buffer is needed for streaming and avaiable
 // memory allows. The send buffer primarily handles messages in Grbl. Only increase if large
 // messages are sent and Grbl begins to stall, waiting to send the rest of the message.
+// The real-time status report is sent from its own small buffer, ahead of any other output, as
+// soon as the line being sent is complete. It must hold a complete report. A longer report, as
+// with many fields enabled in the status report mask, is sent through the regular send buffer.
 // #define RX_BUFFER_SIZE 128 // Uncomment to override defaults in serial.h
 // #define TX_BUFFER_SIZE 64
+// #define TX_STATUS_BUFFER_SIZE 64
+// #define EEPROM_QUEUE_SIZE 8 // Bytes queued for writing by the EEPROM interrupt. See eeprom.h.
   
 // Toggles XON/XOFF software flow control for serial communications. Not officially supported
 // due to problems involving the Atmega8U2 USB-to-serial chips on current Arduinos. The firmware
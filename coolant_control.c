@@ -29,7 +29,6 @@
 #include "coolant_control.h"
 #include "settings.h"
 #include "config.h"
-#include "planner.h"
 
 #include <avr/io.h>
 
@@ -57,7 +56,6 @@ void coolant_run(uint8_t mode)
 {
 	if (mode != current_coolant_mode)
 	{ 
-		plan_synchronize(); // Ensure coolant turns on when specified in program.
 		if (mode == COOLANT_FLOOD_ENABLE) { 
 	  		COOLANT_FLOOD_PORT |= (1 << COOLANT_FLOOD_BIT);
 #ifdef ENABLE_M7  
@@ -40,7 +40,7 @@
 	#define DEFAULT_Y_STEPS_PER_MM			250.0
 	#define DEFAULT_Z_STEPS_PER_MM			250.0
 	#define DEFAULT_STEP_PULSE_MICROSECONDS 10
-	#define DEFAULT_MM_PER_ARC_SEGMENT		0.1
+	#define DEFAULT_ARC_TOLERANCE			0.002 // mm
 	#define DEFAULT_RAPID_FEEDRATE			500.0 // mm/min
 	#define DEFAULT_FEEDRATE				250.0
 	#define DEFAULT_ACCELERATION			(10.0*60*60) // 10*60*60 mm/min^2 = 10 mm/s^2
@@ -54,11 +54,16 @@
 	#define DEFAULT_HOMING_DIR_MASK 		0	  // move positive dir
 	#define DEFAULT_HOMING_RAPID_FEEDRATE	250.0 // mm/min
 	#define DEFAULT_HOMING_FEEDRATE 		25.0  // mm/min
-	#define DEFAULT_HOMING_DEBOUNCE_DELAY	100   // msec (0-65k)
+	#define DEFAULT_LIMIT_DEBOUNCE_TIME		250   // usec (0-65k)
 	#define DEFAULT_HOMING_PULLOFF			1.0   // mm
+	#define DEFAULT_SOFT_LIMIT_ENABLE		0	  // false
+	#define DEFAULT_X_MAX_TRAVEL			200.0 // mm
+	#define DEFAULT_Y_MAX_TRAVEL			200.0 // mm
+	#define DEFAULT_Z_MAX_TRAVEL			200.0 // mm
 	#define DEFAULT_STEPPER_IDLE_LOCK_TIME	25	  // msec (0-255)
 	#define DEFAULT_DECIMAL_PLACES			3
 	#define DEFAULT_N_ARC_CORRECTION		25
+	#define DEFAULT_STATUS_REPORT_MASK		19 // MPos, WPos, buffer state
 #endif
 
 #ifdef DEFAULTS_SHERLINE_5400
@@ -71,7 +76,7 @@
 	#define DEFAULT_Y_STEPS_PER_MM            (STEPS_PER_REV*MICROSTEPS/MM_PER_REV)
 	#define DEFAULT_Z_STEPS_PER_MM            (STEPS_PER_REV*MICROSTEPS/MM_PER_REV)
 	#define DEFAULT_STEP_PULSE_MICROSECONDS   10
-	#define DEFAULT_MM_PER_ARC_SEGMENT        0.1
+	#define DEFAULT_ARC_TOLERANCE             0.002 // mm
 	#define DEFAULT_RAPID_FEEDRATE            635.0 // mm/min (25ipm)
 	#define DEFAULT_FEEDRATE                  254.0 // mm/min (10ipm)
 	#define DEFAULT_ACCELERATION              50.0*60*60 // 50*60*60 mm/min^2 = 50 mm/s^2
@@ -85,11 +90,16 @@
 	#define DEFAULT_HOMING_DIR_MASK           0     // move positive dir
 	#define DEFAULT_HOMING_RAPID_FEEDRATE     250.0 // mm/min
 	#define DEFAULT_HOMING_FEEDRATE           25.0  // mm/min
-	#define DEFAULT_HOMING_DEBOUNCE_DELAY     100   // msec (0-65k)
+	#define DEFAULT_LIMIT_DEBOUNCE_TIME       250   // usec (0-65k)
 	#define DEFAULT_HOMING_PULLOFF            1.0   // mm
+	#define DEFAULT_SOFT_LIMIT_ENABLE         0     // false
+	#define DEFAULT_X_MAX_TRAVEL              225.0 // mm
+	#define DEFAULT_Y_MAX_TRAVEL              125.0 // mm
+	#define DEFAULT_Z_MAX_TRAVEL              170.0 // mm
 	#define DEFAULT_STEPPER_IDLE_LOCK_TIME    25    // msec (0-255)
 	#define DEFAULT_DECIMAL_PLACES            3
 	#define DEFAULT_N_ARC_CORRECTION          25
+	#define DEFAULT_STATUS_REPORT_MASK        19 // MPos, WPos, buffer state
 #endif
 
 #ifdef DEFAULTS_SHAPEOKO
@@ -105,7 +115,7 @@
 	#define DEFAULT_Y_STEPS_PER_MM            (MICROSTEPS_XY*STEP_REVS_XY/MM_PER_REV_XY)
 	#define DEFAULT_Z_STEPS_PER_MM            (MICROSTEPS_Z*STEP_REVS_Z/MM_PER_REV_Z)
 	#define DEFAULT_STEP_PULSE_MICROSECONDS   10
-	#define DEFAULT_MM_PER_ARC_SEGMENT        0.1
+	#define DEFAULT_ARC_TOLERANCE             0.002 // mm
 	#define DEFAULT_RAPID_FEEDRATE            1000.0 // mm/min
 	#define DEFAULT_FEEDRATE                  250.0
 	#define DEFAULT_ACCELERATION              (15.0*60*60) // 15*60*60 mm/min^2 = 15 mm/s^2
@@ -119,11 +129,16 @@
 	#define DEFAULT_HOMING_DIR_MASK           0     // move positive dir
 	#define DEFAULT_HOMING_RAPID_FEEDRATE     250.0 // mm/min
 	#define DEFAULT_HOMING_FEEDRATE           25.0  // mm/min
-	#define DEFAULT_HOMING_DEBOUNCE_DELAY     100   // msec (0-65k)
+	#define DEFAULT_LIMIT_DEBOUNCE_TIME       250   // usec (0-65k)
 	#define DEFAULT_HOMING_PULLOFF            1.0   // mm
+	#define DEFAULT_SOFT_LIMIT_ENABLE         0     // false
+	#define DEFAULT_X_MAX_TRAVEL              200.0 // mm
+	#define DEFAULT_Y_MAX_TRAVEL              200.0 // mm
+	#define DEFAULT_Z_MAX_TRAVEL              200.0 // mm
 	#define DEFAULT_STEPPER_IDLE_LOCK_TIME    255   // msec (0-255)
 	#define DEFAULT_DECIMAL_PLACES            3
 	#define DEFAULT_N_ARC_CORRECTION          25
+	#define DEFAULT_STATUS_REPORT_MASK        19 // MPos, WPos, buffer state
 #endif
 
 #ifdef DEFAULTS_SHAPEOKO_2
@@ -139,7 +154,7 @@
 	#define DEFAULT_Y_STEPS_PER_MM            (MICROSTEPS_XY*STEP_REVS_XY/MM_PER_REV_XY)
 	#define DEFAULT_Z_STEPS_PER_MM            (MICROSTEPS_Z*STEP_REVS_Z/MM_PER_REV_Z)
 	#define DEFAULT_STEP_PULSE_MICROSECONDS   30
-	#define DEFAULT_MM_PER_ARC_SEGMENT        0.1
+	#define DEFAULT_ARC_TOLERANCE             0.002 // mm
 	#define DEFAULT_RAPID_FEEDRATE            500.0  // mm/min
 	#define DEFAULT_FEEDRATE                  500.0
 	#define DEFAULT_ACCELERATION              (25.0*60*60) // 25*60*60 mm/min^2 = 25 mm/s^2
@@ -153,11 +168,16 @@
 	#define DEFAULT_HOMING_DIR_MASK           0      // move positive dir
 	#define DEFAULT_HOMING_RAPID_FEEDRATE     250.0  // mm/min
 	#define DEFAULT_HOMING_FEEDRATE           25.0   // mm/min
-	#define DEFAULT_HOMING_DEBOUNCE_DELAY     100    // msec (0-65k)
+	#define DEFAULT_LIMIT_DEBOUNCE_TIME       250    // usec (0-65k)
 	#define DEFAULT_HOMING_PULLOFF            1.0    // mm
+	#define DEFAULT_SOFT_LIMIT_ENABLE         0      // false
+	#define DEFAULT_X_MAX_TRAVEL              290.0  // mm
+	#define DEFAULT_Y_MAX_TRAVEL              290.0  // mm
+	#define DEFAULT_Z_MAX_TRAVEL              100.0  // mm
 	#define DEFAULT_STEPPER_IDLE_LOCK_TIME    255    // msec (0-255)
 	#define DEFAULT_DECIMAL_PLACES            3
 	#define DEFAULT_N_ARC_CORRECTION          25
+	#define DEFAULT_STATUS_REPORT_MASK        19 // MPos, WPos, buffer state
 #endif
 
 #ifdef DEFAULTS_ZEN_TOOLWORKS_7x7
@@ -171,7 +191,7 @@
 	#define DEFAULT_Y_STEPS_PER_MM            (STEPS_PER_REV*MICROSTEPS/MM_PER_REV)
 	#define DEFAULT_Z_STEPS_PER_MM            (STEPS_PER_REV*MICROSTEPS/MM_PER_REV)
 	#define DEFAULT_STEP_PULSE_MICROSECONDS   10
-	#define DEFAULT_MM_PER_ARC_SEGMENT        0.1
+	#define DEFAULT_ARC_TOLERANCE             0.002 // mm
 	#define DEFAULT_RAPID_FEEDRATE            2500.0 // mm/min
 	#define DEFAULT_FEEDRATE                  1000.0 // mm/min
 	#define DEFAULT_ACCELERATION              150.0*60*60 // 150*60*60 mm/min^2 = 150 mm/s^2
@@ -185,11 +205,16 @@
 	#define DEFAULT_HOMING_DIR_MASK           0     // move positive dir
 	#define DEFAULT_HOMING_RAPID_FEEDRATE     500.0 // mm/min
 	#define DEFAULT_HOMING_FEEDRATE           50.0  // mm/min
-	#define DEFAULT_HOMING_DEBOUNCE_DELAY     100   // msec (0-65k)
+	#define DEFAULT_LIMIT_DEBOUNCE_TIME       250   // usec (0-65k)
 	#define DEFAULT_HOMING_PULLOFF            1.0   // mm
+	#define DEFAULT_SOFT_LIMIT_ENABLE         0     // false
+	#define DEFAULT_X_MAX_TRAVEL              190.0 // mm
+	#define DEFAULT_Y_MAX_TRAVEL              180.0 // mm
+	#define DEFAULT_Z_MAX_TRAVEL              150.0 // mm
 	#define DEFAULT_STEPPER_IDLE_LOCK_TIME    25    // msec (0-255)
 	#define DEFAULT_DECIMAL_PLACES            3
 	#define DEFAULT_N_ARC_CORRECTION          25
+	#define DEFAULT_STATUS_REPORT_MASK        19 // MPos, WPos, buffer state
 #endif
 
 #endif
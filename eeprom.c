@@ -23,6 +23,11 @@
 ****************************************************************************/
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include <stddef.h>
+#include <string.h>
+#include <util/crc16.h>
+#include "nuts_bolts.h"
+#include "eeprom.h"
 
 /* These EEPROM bits have different names on different devices. */
 #ifndef EEPE
@@ -39,6 +44,42 @@
 /* Define to reduce code size. */
 #define EEPROM_IGNORE_SELFPROG //!< Remove SPM flag polling.
 
+// Write queue. eeprom_put_char() only stores the byte here and returns. The EEPROM ready interrupt
+// programs the queued bytes one at a time, each taking about 3.4 ms, so saving settings never
+// stalls the stepper or serial interrupts, and the main program only waits when the queue is full.
+// A write to an address still in the queue replaces the queued value, and reads are served from
+// the queue, so the EEPROM always appears up to date. The queue is drained in order. Only the
+// main program adds entries, while the interrupt removes them. The main program holds off the
+// interrupt by clearing EERIE, rather than disabling all interrupts, whenever it searches the
+// queue or touches the EEPROM registers.
+// 写队列: 写入的字节先存入RAM队列,由EEPROM就绪中断逐字节写入,不再阻塞步进与串口中断.
+typedef struct {
+	unsigned int addr;
+	unsigned char value;
+} eeprom_write_t;
+static eeprom_write_t write_queue[EEPROM_QUEUE_SIZE];
+static volatile uint8_t write_queue_head = 0; // Next free entry. Written by the main program only.
+static volatile uint8_t write_queue_tail = 0; // Next entry to program
+
+static uint8_t next_write_index(uint8_t index)
+{
+	index++;
+	if (index == EEPROM_QUEUE_SIZE) { index = 0; }
+	return(index);
+}
+
+// Returns the queued write to the address, or NULL if there is none. Call with EERIE off.
+static eeprom_write_t *eeprom_find_pending(unsigned int addr)
+{
+	uint8_t index = write_queue_tail;
+	while (index != write_queue_head)
+	{
+		if (write_queue[index].addr == addr) { return(&write_queue[index]); }
+		index = next_write_index(index);
+	}
+	return(NULL);
+}
+
 /*! \brief  Read byte from EEPROM.
  *
  *  This function reads one byte from a given EEPROM address.
@@ -59,14 +100,27 @@
 */
 unsigned char eeprom_get_char( unsigned int addr )
 {
-	do {} while( EECR & (1<<EEPE) );// Wait for completion of previous write.
-									// 等待上一次写操作完成
-	EEAR = addr; 					// Set EEPROM address register.
-									// 设置EEPROM地址寄存器
-	EECR = (1<<EERE);				// Start EEPROM read operation.
-									// 开始执行EEPROM读操作
-	return EEDR;					// Return the byte read from EEPROM.
-									// 对于EEPROM写操作,EEDR是需要写到EEAR单元的数据;对于读操作,EEDR是从地址EEAR读取的数据
+	unsigned char value;
+	EECR &= ~(1<<EERIE);			// Hold off the write queue interrupt while reading.
+									// 读取期间禁止写队列中断
+	eeprom_write_t *pending = eeprom_find_pending(addr);
+	if (pending)
+	{
+		value = pending->value;			// Not written yet. Return the queued value.
+	}
+	else
+	{
+		do {} while( EECR & (1<<EEPE) );// Wait for completion of previous write.
+										// 等待上一次写操作完成
+		EEAR = addr; 					// Set EEPROM address register.
+										// 设置EEPROM地址寄存器
+		EECR |= (1<<EERE);				// Start EEPROM read operation.
+										// 开始执行EEPROM读操作
+		value = EEDR;					// The byte read from EEPROM.
+										// 对于EEPROM写操作,EEDR是需要写到EEAR单元的数据;对于读操作,EEDR是从地址EEAR读取的数据
+	}
+	if (write_queue_tail != write_queue_head) { EECR |= (1<<EERIE); } // Resume the queue.
+	return value;
 }
 
 /*! \brief  Write byte to EEPROM.
@@ -84,6 +138,7 @@ unsigned char eeprom_get_char( unsigned int addr )
  *  \note  The EEPROM_GetChar() function checks the EEPE bit automatically.
  *
  *  \param  addr  EEPROM address to write to.
+ *  \param  old_value  Current EEPROM value.
  *  \param  new_value  New EEPROM value.
  */
 
@@ -96,33 +151,17 @@ unsigned char eeprom_get_char( unsigned int addr )
 返 回 值:	从EEPROM的地址中读取一个字节的信息
 ***********************************************************************************
 */ 
-void eeprom_put_char( unsigned int addr, unsigned char new_value )
+static void eeprom_program( unsigned int addr, unsigned char old_value, unsigned char new_value )
 {
-	char old_value; // Old EEPROM value.
-	char diff_mask; // Difference mask, i.e. old value XOR new value.
+	char diff_mask = old_value ^ new_value; // Get bit differences.
+	unsigned char eerie = EECR & (1<<EERIE); // Keep the interrupt enable bit, written along below.
+	// EEPE must be set within four cycles of EEMPE. The main program also gets here when the write
+	// queue is full, so an interrupt in between would time out EEMPE and silently lose the byte.
+	uint8_t sreg = SREG;
+	cli();
 
-	//This part refer to "EECR – The EEPROM Control Register" of ATMeag328P pdf.
-	
-	cli();          // Ensure atomic operation for the write operation.
-				    // 清除中断，由一条汇编语句完成
-	
-	do {} while( EECR & (1<<EEPE) ); 	    // Wait for completion of previous write.
-											// 等待上一次写操作结束
-	#ifndef EEPROM_IGNORE_SELFPROG
-	do {} while( SPMCSR & (1<<SELFPRGEN) ); // Wait for completion of SPM.
-                                            // SPMEN 置位，SPM 指令将把R1:R0 中的数据存储到由Z 指针确定的临时页缓冲器。Z 指针的LSB
-                                            // 被忽略。SPM 指令完成，或在四个时钟周期内没有SPM 指令被执行时，SPMEN 自动清零。在页擦
-                                            // 除和页写过程中SPMEN 保持为1直到操作完成。
-	#endif
-	
 	EEAR = addr;        // Set EEPROM address register.
                         // 设置EEPROM的地址寄存器
-	EECR = (1<<EERE);   // Start EEPROM read operation.
-                        // 置位EERE以便将数据读入EEAR
-	old_value = EEDR;   // Get old EEPROM value.
-                        // 对于EEPROM写操作，EEDR是需要写到EEAR单元的数据；
-                        // 对于读操作，EEDR是从地址EEAR读取的数据。
-	diff_mask = old_value ^ new_value; // Get bit differences.
 	
 	// Check if any bits are changed to '1' in the new value.
 	if( diff_mask & new_value ) 
@@ -136,7 +175,7 @@ void eeprom_put_char( unsigned int addr, unsigned char new_value )
 			
 			EEDR = new_value;	// Set EEPROM data register.
 										// 将数据写入EEDR
-			EECR = (1<<EEMPE) | 	// Set Master Write Enable bit...
+			EECR = eerie | (1<<EEMPE) | 	// Set Master Write Enable bit...
 										// 置位用于在设置EEPE后在四个时钟周期内将数据写入EEPROM
 			       (0<<EEPM1) | (0<<EEPM0); // ...and Erase+Write mode.
 			       					// 向EEPROM中写数据时执行擦除和写模式的操作
@@ -147,7 +186,7 @@ void eeprom_put_char( unsigned int addr, unsigned char new_value )
 		{
 			// Now we know that all bits should be erased.
 
-			EECR = (1<<EEMPE) | // Set Master Write Enable bit...
+			EECR = eerie | (1<<EEMPE) | // Set Master Write Enable bit...
 			       (1<<EEPM0);  // ...and Erase-only mode.
 			EECR |= (1<<EEPE);  // Start Erase-only operation.
 		}
@@ -162,38 +201,150 @@ void eeprom_put_char( unsigned int addr, unsigned char new_value )
 			// Now we know that _some_ bits need to the programmed to '0'.
 			
 			EEDR = new_value;	// Set EEPROM data register.
-			EECR = (1<<EEMPE) |	// Set Master Write Enable bit...
+			EECR = eerie | (1<<EEMPE) |	// Set Master Write Enable bit...
 			       (1<<EEPM1);	// ...and Write-only mode.
 			EECR |= (1<<EEPE);	// Start Write-only operation.
 		}
 	}
-	
-	sei();	// Restore interrupt flag state.
-				//中断使能开
+	SREG = sreg; // Restore the interrupt state.
 }
 
 // Extensions added as part of Grbl 
 
-// 将source中的size个数据写入从地址destination开始的EEPROM中
-void memcpy_to_eeprom_with_checksum(unsigned int destination, char *source, unsigned int size) 
+// Programs the next queued byte that differs from the EEPROM content. Bytes that already hold
+// their value are dropped without a write cycle. Turns the interrupt off once the queue is empty.
+// Assumes no write is in progress.
+static void eeprom_write_next()
+{
+	while (write_queue_tail != write_queue_head)
+	{
+		unsigned int addr = write_queue[write_queue_tail].addr;
+		unsigned char value = write_queue[write_queue_tail].value;
+		write_queue_tail = next_write_index(write_queue_tail);
+		EEAR = addr;
+		EECR |= (1<<EERE); // Read the old value.
+		if (EEDR != value) 
+		{
+			eeprom_program(addr, EEDR, value);
+			return;
+		}
+	}
+	EECR &= ~(1<<EERIE);
+}
+
+// EEPROM ready interrupt. Fires while EERIE is set and no write is in progress.
+ISR(EE_READY_vect)
 {
-	unsigned char checksum = 0;
+	eeprom_write_next();
+}
+
+// Queues a byte for writing. Only waits, if the queue is full, by programming the oldest byte
+// directly. This also works with interrupts disabled, such as during startup.
+void eeprom_put_char( unsigned int addr, unsigned char new_value )
+{
+	EECR &= ~(1<<EERIE); // Hold off the write queue interrupt.
+	eeprom_write_t *pending = eeprom_find_pending(addr);
+	if (pending)
+	{
+		pending->value = new_value; // Still queued. Replace the value.
+		EECR |= (1<<EERIE);
+		return;
+	}
+
+	uint8_t next_head = next_write_index(write_queue_head);
+	while (next_head == write_queue_tail)
+	{
+		// Queue full. 队列已满,等待当前写操作完成后直接写入最早的字节
+		do {} while( EECR & (1<<EEPE) ); // Wait for completion of previous write.
+		eeprom_write_next();
+	}
+	write_queue[write_queue_head].addr = addr;
+	write_queue[write_queue_head].value = new_value;
+	write_queue_head = next_head;
+	EECR |= (1<<EERIE); // Fires right away, if no write is in progress.
+}
+
+// Returns true when the write queue has room, so the next eeprom_put_char() does not wait.
+unsigned char eeprom_is_ready()
+{
+	return(next_write_index(write_queue_head) != write_queue_tail);
+}
+
+// Queues a byte for writing, unless the EEPROM already holds it. Waits for a write in progress to
+// compare, so it is meant for the foreground saves, not for the background write-back.
+void eeprom_update_char(unsigned int addr, unsigned char new_value)
+{
+	if (eeprom_get_char(addr) != new_value) { eeprom_put_char(addr, new_value); }
+}
+
+// Records are stored as [version][length][data][CRC low][CRC high]. The CRC-16/CCITT covers the
+// header and the data, so a record of another version or size is rejected like a corrupted one.
+// 记录格式: 版本,长度,数据,CRC16校验
+unsigned int eeprom_record_crc(unsigned char version, char *source, unsigned char size)
+{
+	unsigned int crc = 0xffff;
+	crc = _crc_ccitt_update(crc, version);
+	crc = _crc_ccitt_update(crc, size);
+	for(; size > 0; size--) { crc = _crc_ccitt_update(crc, *(source++)); }
+	return(crc);
+}
+
+// Assembles a complete record in RAM, EEPROM_RECORD_SIZE(size) bytes, for writing it piecewise.
+void eeprom_pack_record(char *record, unsigned char version, char *source, unsigned char size)
+{
+	unsigned int crc = eeprom_record_crc(version, source, size);
+	*(record++) = version;
+	*(record++) = size;
+	memcpy(record, source, size);
+	record += size;
+	*(record++) = crc & 0xff;
+	*record = crc >> 8;
+}
+
+// 将source中的size个数据作为记录写入从地址destination开始的EEPROM中
+// Only bytes that differ from the EEPROM content are queued, so rewriting a record after a small
+// change costs just the changed bytes and the CRC, in time and in wear.
+void eeprom_write_record(unsigned int destination, unsigned char version, char *source, unsigned char size)
+{
+	unsigned int crc = eeprom_record_crc(version, source, size);
+	eeprom_update_char(destination++, version);
+	eeprom_update_char(destination++, size);
+	for(; size > 0; size--) { eeprom_update_char(destination++, *(source++)); }
+	eeprom_update_char(destination++, crc & 0xff);
+	eeprom_update_char(destination, crc >> 8);
+}
+
+// 从地址source开始读取记录,将数据送入缓冲区destination中
+// Returns false if the header does not match the expected version and size, or the CRC fails. The
+// destination may be overwritten in either case.
+unsigned char eeprom_read_record(char *destination, unsigned int source, unsigned char version, unsigned char size)
+{
+	if (eeprom_get_char(source) != version || eeprom_get_char(source+1) != size) { return(0); }
+	source += 2;
+	unsigned char data;
+	unsigned int crc = 0xffff;
+	crc = _crc_ccitt_update(crc, version);
+	crc = _crc_ccitt_update(crc, size);
 	for(; size > 0; size--) 
 	{ 
-		checksum = (checksum << 1) || (checksum >> 7);
-		checksum += *source;
-		eeprom_put_char(destination++, *(source++)); 
+		data = eeprom_get_char(source++);
+		crc = _crc_ccitt_update(crc, data);
+		*(destination++) = data; 
 	}
-	eeprom_put_char(destination, checksum);
+	unsigned int stored_crc = eeprom_get_char(source);
+	stored_crc |= (unsigned int)eeprom_get_char(source+1) << 8;
+	return(crc == stored_crc);
 }
+
 // 从地址source开始读取size个字节,将读取的数据送入缓冲区destination中
+// Reads the single checksum byte records of settings versions before 9, only to migrate them.
 int memcpy_from_eeprom_with_checksum(char *destination, unsigned int source, unsigned int size) 
 {
 	unsigned char data, checksum = 0;
 	for(; size > 0; size--) 
 	{ 
 		data = eeprom_get_char(source++);
-		checksum = (checksum << 1) || (checksum >> 7);
+		checksum = (checksum != 0); // Reproduces the legacy logical-OR checksum
 		checksum += data;    
 		*(destination++) = data; 
 	}
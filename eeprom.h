@@ -29,9 +29,23 @@
 #ifndef eeprom_h
 #define eeprom_h
 
-char eeprom_get_char(unsigned int addr);
+// Number of bytes the EEPROM write queue holds. Writes beyond wait for the oldest byte to be
+// programmed, about 3.4 ms each. Each entry takes 3 bytes of RAM.
+#ifndef EEPROM_QUEUE_SIZE
+  #define EEPROM_QUEUE_SIZE 8
+#endif
+
+// Bytes a record takes in EEPROM: version and length header, data and CRC-16.
+#define EEPROM_RECORD_SIZE(size) ((size)+4)
+
+unsigned char eeprom_get_char(unsigned int addr);
 void eeprom_put_char( unsigned int addr, unsigned char new_value );
-void memcpy_to_eeprom_with_checksum(unsigned int destination, char *source, unsigned int size);
+void eeprom_update_char(unsigned int addr, unsigned char new_value);
+unsigned char eeprom_is_ready();
+unsigned int eeprom_record_crc(unsigned char version, char *source, unsigned char size);
+void eeprom_pack_record(char *record, unsigned char version, char *source, unsigned char size);
+void eeprom_write_record(unsigned int destination, unsigned char version, char *source, unsigned char size);
+unsigned char eeprom_read_record(char *destination, unsigned int source, unsigned char version, unsigned char size);
 int memcpy_from_eeprom_with_checksum(char *destination, unsigned int source, unsigned int size);
 
 #endif
@@ -41,6 +41,7 @@
 #include "errno.h"
 #include "protocol.h"
 #include "report.h"
+#include "limits.h"
 
 // Declare gc extern struct
 parser_state_t gc;	// 分析程序
@@ -64,8 +65,9 @@ void gc_init()
 	select_plane(X_AXIS, Y_AXIS, Z_AXIS);
 	gc.absolute_mode = true;
 
-	// Load default G54 coordinate system.
-	if (!(settings_read_coord_data(gc.coord_select,gc.coord_system)))
+	// Load default G54 coordinate system and the last G92 offset.
+	if (!(settings_read_coord_data(gc.coord_select,gc.coord_system)) ||
+	    !(settings_read_coord_data(SETTING_INDEX_G92,gc.coord_offset)))
 	{ 
 		report_status_message(STATUS_SETTING_READ_FAIL); 
 	} 
@@ -104,6 +106,7 @@ uint8_t gc_execute_line(char *line)
 
 	uint16_t modal_group_words = 0;  // Bitflag variable to track and check modal group words in block
 	uint8_t axis_words = 0;          // Bitflag to track which XYZ(ABC) parameters exist in block
+	uint8_t offset_words = 0;        // Bitflag to track which IJK parameters exist in block
 
 	float inverse_feed_rate = -1;    // negative inverse_feed_rate means no inverse_feed_rate specified
 	uint8_t absolute_override = false;         // true(1) = absolute motion for this block only {G53}
@@ -128,7 +131,7 @@ uint8_t gc_execute_line(char *line)
 				switch(int_value)
 				{
 					case 4: case 10: case 28: case 30: case 53: case 92: group_number = MODAL_GROUP_0; break;
-					case 0: case 1: case 2: case 3: case 80: group_number = MODAL_GROUP_1; break;
+					case 0: case 1: case 2: case 3: case 5: case 80: group_number = MODAL_GROUP_1; break;
 					case 17: case 18: case 19: group_number = MODAL_GROUP_2; break;
 					case 90: case 91: group_number = MODAL_GROUP_3; break;
 					case 93: case 94: group_number = MODAL_GROUP_5; break;
@@ -144,6 +147,7 @@ uint8_t gc_execute_line(char *line)
 					case 2: gc.motion_mode = MOTION_MODE_CW_ARC; break;
 					case 3: gc.motion_mode = MOTION_MODE_CCW_ARC; break;
 					case 4: non_modal_action = NON_MODAL_DWELL; break;
+					case 5: gc.motion_mode = MOTION_MODE_CUBIC_SPLINE; break;
 					case 10: non_modal_action = NON_MODAL_SET_COORDINATE_DATA; break;
 					case 17: select_plane(X_AXIS, Y_AXIS, Z_AXIS); break;
 					case 18: select_plane(Z_AXIS, X_AXIS, Y_AXIS); break;
@@ -229,14 +233,16 @@ uint8_t gc_execute_line(char *line)
 	/* Pass 2: Parameters. All units converted according to current block commands. Position 
 	parameters are converted and flagged to indicate a change. These can have multiple connotations
 	for different commands. Each will be converted to their proper value upon execution. */
-	float p = 0, r = 0;
+	float p = 0, q = 0, r = 0;
 	uint8_t l = 0;
+	uint8_t pq_words = 0;  // Bitflag to track P(bit 0) and Q(bit 1) parameters in block
 	char_counter = 0;
   	while(next_statement(&letter, &value, line, &char_counter)) 
 	{
 		switch(letter)
 		{
-			case 'G': case 'M': case 'N': break; // Ignore command statements and line numbers
+			case 'G': case 'M': break; // Ignore command statements
+			case 'N': gc.line_number = trunc(value); break;
 			case 'F': 
 				if (value <= 0) { FAIL(STATUS_INVALID_STATEMENT); } // Must be greater than zero
 				if (gc.inverse_feed_rate_mode)
@@ -248,9 +254,13 @@ uint8_t gc_execute_line(char *line)
 					gc.feed_rate = to_millimeters(value);      // millimeters per minute
 				}
 				break;
-			case 'I': case 'J': case 'K': offset[letter-'I'] = to_millimeters(value); break;
+			case 'I': case 'J': case 'K': 
+				offset[letter-'I'] = to_millimeters(value); 
+				bit_true(offset_words,bit((letter-'I'))); 
+				break;
 			case 'L': l = trunc(value); break;
-			case 'P': p = value; break;                    
+			case 'P': p = value; bit_true(pq_words,bit(0)); break;                    
+			case 'Q': q = value; bit_true(pq_words,bit(1)); break;
 			case 'R': r = to_millimeters(value); break;
 			case 'S': 
 				if (value < 0) { FAIL(STATUS_INVALID_STATEMENT); } // Cannot be negative
@@ -283,9 +293,9 @@ uint8_t gc_execute_line(char *line)
 	{ 
 		// ([M6]: Tool change should be executed here.)
 		// [M3,M4,M5]: Update spindle state
-		spindle_run(gc.spindle_direction);
 		// [*M7,M8,M9]: Update coolant state
-		coolant_run(gc.coolant_mode);
+		// NOTE: Queued with the motions, so the change is applied when the next motion starts.
+		mc_set_accessory_state(gc.spindle_direction, gc.coolant_mode);
 	}
   
 	// [G54,G55,...,G59]: Coordinate system selection
@@ -418,11 +428,13 @@ uint8_t gc_execute_line(char *line)
 						gc.coord_offset[i] = gc.position[i]-gc.coord_system[i]-target[i];
 					}
 				}
+				settings_write_coord_data(SETTING_INDEX_G92,gc.coord_offset); // Persists across resets
 			}
 			axis_words = 0; // Axis words used. Lock out from motion modes by clearing flags.
 			break;
 		case NON_MODAL_RESET_COORDINATE_OFFSET: 
 			clear_vector(gc.coord_offset); // Disable G92 offsets by zeroing offset vector.
+			settings_write_coord_data(SETTING_INDEX_G92,gc.coord_offset);
 			break;
 	}
 
@@ -618,7 +630,41 @@ uint8_t gc_execute_line(char *line)
 					r, isclockwise);
     			}            
    				break;
+			case MOTION_MODE_CUBIC_SPLINE:
+				// G5 cubic spline in the XY plane. I,J is the first control point relative to the start
+				// point and P,Q is the second control point relative to the end point. P,Q are required.
+				// I,J may be omitted only directly after another G5, where the first control point then
+				// mirrors the previous second control point to keep the path tangent continuous.
+				if ((gc.plane_axis_0 != X_AXIS) || (gc.plane_axis_1 != Y_AXIS) || (pq_words != (bit(0)|bit(1))))
+				{
+					FAIL(STATUS_INVALID_STATEMENT);
+				}
+				else if (!offset_words)
+				{
+					if (!gc.spline_tangent_valid) { FAIL(STATUS_INVALID_STATEMENT); }
+					offset[X_AXIS] = -gc.spline_tangent[X_AXIS];
+					offset[Y_AXIS] = -gc.spline_tangent[Y_AXIS];
+				}
+				else if (offset_words != (bit(X_AXIS)|bit(Y_AXIS)))
+				{
+					FAIL(STATUS_INVALID_STATEMENT); // I and J must be given together. No K in the XY plane.
+				}
+				if (!gc.status_code)
+				{
+					float first_control[2], second_control[2];
+					first_control[X_AXIS] = gc.position[X_AXIS] + offset[X_AXIS];
+					first_control[Y_AXIS] = gc.position[Y_AXIS] + offset[Y_AXIS];
+					gc.spline_tangent[X_AXIS] = to_millimeters(p);
+					gc.spline_tangent[Y_AXIS] = to_millimeters(q);
+					second_control[X_AXIS] = target[X_AXIS] + gc.spline_tangent[X_AXIS];
+					second_control[Y_AXIS] = target[Y_AXIS] + gc.spline_tangent[Y_AXIS];
+					mc_bezier(gc.position, target, first_control, second_control,
+					(gc.inverse_feed_rate_mode) ? inverse_feed_rate : gc.feed_rate, gc.inverse_feed_rate_mode);
+				}
+				break;
 		}
+		// Only a G5 directly following another G5 may continue its tangent.
+		gc.spline_tangent_valid = ((gc.motion_mode == MOTION_MODE_CUBIC_SPLINE) && !gc.status_code);
 
 		// Report any errors.
 		if (gc.status_code) { return(gc.status_code); }    
@@ -645,6 +691,74 @@ uint8_t gc_execute_line(char *line)
 	return(gc.status_code);
 }
 
+// Executes a jog line, the part of a '$J=' command after the '='. Accepts G20/G21, G90/G91 and G53
+// for this line only, X, Y, Z and a required F word, which is always in units per minute. The
+// parser modes are left unchanged. Only the parser position follows the jog.
+uint8_t gc_execute_jog(char *line)
+{
+	uint8_t char_counter = 0;
+	char letter;
+	float value;
+	uint8_t i;
+	uint8_t inches_mode = gc.inches_mode;
+	uint8_t absolute_mode = gc.absolute_mode;
+	uint8_t absolute_override = false; // G53
+	uint8_t axis_words = 0;
+	float feed_rate = 0;
+	float target[N_AXIS];
+
+	gc.status_code = STATUS_OK;
+	while(next_statement(&letter, &value, line, &char_counter))
+	{
+		switch(letter)
+		{
+			case 'G':
+				switch((int)trunc(value))
+				{
+					case 20: inches_mode = true; break;
+					case 21: inches_mode = false; break;
+					case 53: absolute_override = true; break;
+					case 90: absolute_mode = true; break;
+					case 91: absolute_mode = false; break;
+					default: return(STATUS_UNSUPPORTED_STATEMENT);
+				}
+				break;
+			case 'X': case 'Y': case 'Z':
+				i = letter-'X';
+				target[i] = value;
+				bit_true(axis_words,bit(i));
+				break;
+			case 'F': feed_rate = value; break;
+			default: return(STATUS_UNSUPPORTED_STATEMENT);
+		}
+	}
+	if (gc.status_code) { return(gc.status_code); }
+	if (!axis_words || feed_rate <= 0) { return(STATUS_INVALID_STATEMENT); }
+
+	// Convert to an absolute machine target in millimeters. Axes not given stay where they are.
+	if (inches_mode) { feed_rate *= MM_PER_INCH; }
+	for (i=0; i<N_AXIS; i++)
+	{
+		if (bit_istrue(axis_words,bit(i)))
+		{
+			if (inches_mode) { target[i] *= MM_PER_INCH; }
+			if (absolute_override) { continue; } // Machine coordinates
+			if (absolute_mode) { target[i] += gc.coord_system[i]+gc.coord_offset[i]; }
+			else { target[i] += gc.position[i]; }
+		}
+		else
+		{
+			target[i] = gc.position[i];
+		}
+	}
+
+	// A jog beyond the soft limits is rejected, rather than raising an alarm.
+	if (limits_soft_exceeded(target, target)) { return(STATUS_SOFT_LIMIT); }
+
+	if (mc_jog(target, feed_rate)) { memcpy(gc.position, target, sizeof(target)); }
+	return(STATUS_OK);
+}
+
 // Parses the next statement and leaves the counter on the first character following
 // the statement. Returns 1 if there was a statements, 0 if end of string was reached
 // or there was an error (check state.status_code).
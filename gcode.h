@@ -39,7 +39,7 @@
 // and are similar/identical to other g-code interpreters by manufacturers (Haas,Fanuc,Mazak,etc).
 #define MODAL_GROUP_NONE	0
 #define MODAL_GROUP_0 		1 // [G4,G10,G28,G30,G53,G92,G92.1] Non-modal
-#define MODAL_GROUP_1 		2 // [G0,G1,G2,G3,G80] Motion
+#define MODAL_GROUP_1 		2 // [G0,G1,G2,G3,G5,G80] Motion
 #define MODAL_GROUP_2 		3 // [G17,G18,G19] Plane selection
 #define MODAL_GROUP_3 		4 // [G90,G91] Distance mode
 #define MODAL_GROUP_4 		5 // [M0,M1,M2,M30] Stopping
@@ -55,6 +55,7 @@
 #define MOTION_MODE_CW_ARC 	2 // G2
 #define MOTION_MODE_CCW_ARC 3 // G3
 #define MOTION_MODE_CANCEL 	4 // G80
+#define MOTION_MODE_CUBIC_SPLINE 5 // G5
 
 #define PROGRAM_FLOW_RUNNING 	0
 #define PROGRAM_FLOW_PAUSED 	1 // M0, M1
@@ -72,7 +73,7 @@
 
 typedef struct {
 	uint8_t status_code;             // Parser status for current block
-	uint8_t motion_mode;             // {G0, G1, G2, G3, G80}
+	uint8_t motion_mode;             // {G0, G1, G2, G3, G5, G80}
 	uint8_t inverse_feed_rate_mode;  // {G93, G94}
 	uint8_t inches_mode;             // 0 = millimeter mode, 1 = inches mode {G20, G21}
 	uint8_t absolute_mode;           // 0 = relative motion, 1 = absolute motion {G90, G91}
@@ -93,6 +94,9 @@ typedef struct {
 	                                 // position in mm. Loaded from EEPROM when called.
 	float   coord_offset[N_AXIS];    // Retains the G92 coordinate offset (work coordinates) relative to
 	                                 // machine zero in mm. Non-persistent. Cleared upon reset and boot.        
+	float   spline_tangent[2];       // Second control point (P,Q) of the last G5 move, relative to its end point.
+	uint8_t spline_tangent_valid;    // True when the last motion was a G5 move, which a G5 without I,J continues.
+	int32_t line_number;             // Last N line number parsed. Reported in the real-time status.
 } parser_state_t;
 extern parser_state_t gc;
 
@@ -102,6 +106,9 @@ void gc_init();
 // Execute one block of rs275/ngc/g-code
 uint8_t gc_execute_line(char *line);
 
+// Execute a jog line, as given after '$J='
+uint8_t gc_execute_jog(char *line);
+
 // Set g-code parser position. Input in steps.
 void gc_set_current_position(int32_t x, int32_t y, int32_t z); 
 
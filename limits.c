@@ -40,10 +40,44 @@
 #include "limits.h"
 #include "report.h"
 
-#define MICROSECONDS_PER_ACCELERATION_TICK  (1000000/ACCELERATION_TICKS_PER_SECOND)
+// Parked position handling. While the machine position is trusted, it is saved to EEPROM as
+// cleanly parked when the steppers go idle holding their position, or on the '$S' command. Any
+// motion clears it first, so a position lost during a motion is never trusted. After power up,
+// '$H' then re-homes quickly from the parked position, instead of searching the full travel.
+static uint8_t parked;
+
+// Limit pin debouncing. Timer0 samples the limit pins every LIMIT_DEBOUNCE_PERIOD while homing,
+// and after a pin change while hard limits are enabled. Each pin keeps its own count of samples
+// in a row reading the same level, and its state only counts once it held for debounce_samples,
+// so edges shorter than the debounce time setting are filtered out without busy waiting, and a
+// chattering switch on one axis does not hold off the others.
+#ifdef GANTRY_SLAVE_AXIS
+  #define N_LIMIT_PINS (N_AXIS+1) // Slave axis limit pin last.
+#else
+  #define N_LIMIT_PINS N_AXIS
+#endif
+static volatile uint8_t limit_state;       // Debounced limit pin levels
+static uint8_t limit_sample;               // Last limit pin levels sampled
+static uint16_t limit_count[N_LIMIT_PINS]; // Samples in a row each pin read its limit_sample level
+static uint16_t debounce_samples;          // Samples to confirm a pin state. Derived from the setting.
+
+#define LIMIT_DEBOUNCE_TICKS (LIMIT_DEBOUNCE_PERIOD*(F_CPU/8000000L)) // Timer0 ticks at 1/8 prescaler
+
 // 限位初始化
 void limits_init() 
 {
+	float position[N_AXIS];
+	settings_read_coord_data(SETTING_INDEX_PARK, position);
+	parked = !isnan(position[X_AXIS]);
+
+	// Up to 1311 samples at 50usec, for the full 0-65535usec range of the setting.
+	debounce_samples = (settings.limit_debounce_time+(LIMIT_DEBOUNCE_PERIOD-1UL))/LIMIT_DEBOUNCE_PERIOD;
+	if (debounce_samples < 1) { debounce_samples = 1; }
+	TCCR0B = 0; // Debounce timer stopped until needed.
+	TCCR0A = (1<<WGM01); // CTC mode
+	OCR0A = LIMIT_DEBOUNCE_TICKS-1;
+	TIMSK0 |= (1<<OCIE0A);
+
 	LIMIT_DDR &= ~(LIMIT_MASK); // Set as input pins
 #ifndef LIMIT_SWITCHES_ACTIVE_HIGH
 	LIMIT_PORT |= (LIMIT_MASK); // Enable internal pull-up resistors. Normal high operation.
@@ -62,22 +96,70 @@ void limits_init()
 	}
 }
 
-// This is the Limit Pin Change Interrupt, which handles the hard limit feature. A bouncing 
-// limit switch can cause a lot of problems, like false readings and multiple interrupt calls.
-// If a switch is triggered at all, something bad has happened and treat it as such, regardless
-// if a limit switch is being disengaged. It's impossible to reliably tell the state of a 
-// bouncing pin without a debouncing method.
+// Starts sampling the limit pins, unless already running. The debounced state starts out at the
+// current pin levels, which still have to read the same for the debounce time to be confirmed.
+static void debounce_start()
+{
+	if (TCCR0B) { return; }
+	limit_sample = LIMIT_PIN & LIMIT_MASK;
+	limit_state = limit_sample;
+	uint8_t idx;
+	for (idx=0; idx<N_LIMIT_PINS; idx++) { limit_count[idx] = 1; }
+	TCNT0 = 0;
+	TCCR0B = (1<<CS01); // Begin timer0. 1/8 prescaler
+}
+
+// This is the Limit Pin Change Interrupt, which handles the hard limit feature. A bouncing or 
+// noisy limit switch input can cause a lot of problems, like false readings and multiple interrupt
+// calls. So a pin change only starts the debounce timer, which confirms a triggered switch or
+// filters out a spurious edge within the debounce time.
 // NOTE: Do not attach an e-stop to the limit pins, because this interrupt is disabled during
 // homing cycles and will not respond correctly. Upon user request or need, there may be a
 // special pinout for an e-stop, but it is generally recommended to just directly connect
 // your e-stop switch to the Arduino reset pin, since it is the most correct way to do this.
 ISR(LIMIT_INT_vect) 
 {
-	// TODO: This interrupt may be used to manage the homing cycle directly with the main stepper
-	// interrupt without adding too much to it. All it would need is some way to stop one axis 
-	// when its limit is triggered and continue the others. This may reduce some of the code, but
-	// would make Grbl a little harder to read and understand down road. Holding off on this until
-	// we move on to new hardware or flash space becomes an issue. If it ain't broke, don't fix it.
+	debounce_start();
+}
+
+// Counts the samples in a row a limit pin reads the same level, and confirms that level in
+// limit_state once it held for the debounce samples. Returns the pin bit, if confirmed.
+static uint8_t debounce_pin(uint8_t idx, uint8_t pin_bit, uint8_t sample)
+{
+	if ((sample ^ limit_sample) & pin_bit) { limit_count[idx] = 1; }
+	else if (limit_count[idx] < debounce_samples) { limit_count[idx]++; }
+	if (limit_count[idx] < debounce_samples) { return(0); }
+	limit_state = (limit_state & ~pin_bit) | (sample & pin_bit);
+	return(pin_bit);
+}
+
+// Limit pin sampling interrupt. Confirms each pin state on its own debounce samples. While
+// homing, it keeps sampling for the stepper interrupt, which stops each axis on its confirmed
+// switch state. Otherwise, a confirmed triggered switch is a hard limit event right away, and
+// sampling stops once all pins have settled.
+ISR(TIMER0_COMPA_vect)
+{
+	uint8_t sample = LIMIT_PIN & LIMIT_MASK;
+	uint8_t confirmed = debounce_pin(X_AXIS,(1<<X_LIMIT_BIT),sample);
+	confirmed |= debounce_pin(Y_AXIS,(1<<Y_LIMIT_BIT),sample);
+	confirmed |= debounce_pin(Z_AXIS,(1<<Z_LIMIT_BIT),sample);
+	#ifdef GANTRY_SLAVE_AXIS
+		confirmed |= debounce_pin(N_AXIS,(1<<SLAVE_LIMIT_BIT),sample);
+	#endif
+	limit_sample = sample;
+	if (sys.state == STATE_HOMING) { return; }
+
+	uint8_t triggered = limit_state;
+	#ifndef LIMIT_SWITCHES_ACTIVE_HIGH
+		triggered ^= LIMIT_MASK; // Pulled up. A low pin is a triggered switch.
+	#endif
+	triggered &= confirmed;
+	if (!triggered)
+	{
+		if (confirmed == LIMIT_MASK) { TCCR0B = 0; } // Settled. Stop sampling until the next pin change.
+		return; // Spurious edge, a switch released, or still bouncing.
+	}
+	TCCR0B = 0;
 
 	// Ignore limit switches if already in an alarm state or in-process of executing an alarm.
 	// When in the alarm state, Grbl should have been reset or will force a reset, so any pending 
@@ -88,180 +170,236 @@ ISR(LIMIT_INT_vect)
 	{ 
 		if (bit_isfalse(sys.execute,EXEC_ALARM)) 
 		{
+			sys.homed = false; // Position no longer trusted.
 			mc_reset(); // Initiate system kill.
 			sys.execute |= EXEC_CRIT_EVENT; // Indicate hard limit critical event
 		}
 	}
 }
 
+// Returns the debounced limit pin levels. Only current while homing, or after a pin change.
+uint8_t limits_get_state()
+{
+	return(limit_state);
+}
 
-// Moves all specified axes in same specified direction (positive=true, negative=false)
-// and at the homing rate. Homing is a special motion case, where there is only an 
-// acceleration followed by abrupt asynchronous stops by each axes reaching their limit 
-// switch independently. Instead of shoehorning homing cycles into the main stepper 
-// algorithm and overcomplicate things, a stripped-down, lite version of the stepper 
-// algorithm is written here. This also lets users hack and tune this code freely for
-// their own particular needs without affecting the rest of Grbl.
+
+void limits_park()
+{
+  if (!sys.homed) { return; }
+  float position[N_AXIS];
+  uint8_t idx;
+  for (idx=0; idx<N_AXIS; idx++) { position[idx] = sys.position[idx]/settings.steps_per_mm[idx]; }
+  settings_write_coord_data(SETTING_INDEX_PARK, position);
+  parked = true;
+}
+
+void limits_unpark()
+{
+  if (!parked) { return; }
+  float position[N_AXIS];
+  position[X_AXIS] = position[Y_AXIS] = position[Z_AXIS] = NAN;
+  settings_write_coord_data(SETTING_INDEX_PARK, position);
+  parked = false;
+}
+
+uint8_t limits_is_parked()
+{
+  return(parked);
+}
+
+
+// Returns true, if the box from box_min to box_max in machine coordinates leaves the workspace
+// envelope. A point is checked as a box with both corners at it. Only checked once homed, since
+// the envelope is meaningless without a trusted machine position. Machine zero is at the homing
+// switches, so each axis spans its max travel away from its switch. The envelope is taken straight
+// from the settings, which only costs a few compares and no RAM.
+uint8_t limits_soft_exceeded(float *box_min, float *box_max)
+{
+  if (bit_isfalse(settings.flags,BITFLAG_SOFT_LIMIT_ENABLE) || !sys.homed) { return(false); }
+  uint8_t direction_bit[N_AXIS] = { (1<<X_DIRECTION_BIT), (1<<Y_DIRECTION_BIT), (1<<Z_DIRECTION_BIT) };
+  uint8_t idx;
+  for (idx=0; idx<N_AXIS; idx++) {
+    if (bit_istrue(settings.homing_dir_mask,direction_bit[idx])) {
+      // Switch at the negative end
+      if (box_min[idx] < 0.0 || box_max[idx] > settings.max_travel[idx]) { return(true); }
+    } else {
+      if (box_min[idx] < -settings.max_travel[idx] || box_max[idx] > 0.0) { return(true); }
+    }
+  }
+  return(false);
+}
+
+// Stops the machine upon a soft limit violation without losing its position. A running cycle is
+// brought to a controlled stop with a feed hold first. Then the reset discards the buffered and
+// queued motions, and the alarm locks out the rest of the program. The machine stays homed.
+void limits_soft_alarm()
+{
+  if (sys.state == STATE_CYCLE || sys.state == STATE_HOLD) {
+    sys.execute |= EXEC_FEED_HOLD;
+    do {
+      protocol_execute_runtime();
+      if (sys.abort) { return; }
+    } while (sys.state == STATE_CYCLE || sys.state == STATE_HOLD);
+  }
+  report_alarm_message(ALARM_SOFT_LIMIT);
+  sys.state = STATE_ALARM; // Not a motion state, so the reset keeps the steppers and the position.
+  mc_reset();
+  protocol_execute_runtime(); // Set system abort.
+}
+
+
+// Returns the homing axis mask of a homing cycle. A dual-motor gantry axis includes its slaved motor.
+static uint8_t homing_mask(uint8_t cycle_mask)
+{
+  #ifdef GANTRY_SLAVE_AXIS
+    if (bit_istrue(cycle_mask,bit(GANTRY_SLAVE_AXIS))) { cycle_mask |= SLAVE_AXIS_MASK; }
+  #endif
+  return(cycle_mask);
+}
+
+// Moves all specified axes towards (approach=true) or away from their limit switches at the given
+// rate, each up to its travel. The motion is planned like any other, so it accelerates at the
+// machine acceleration, and is run by the stepper interrupt, which checks the limit pins at every
+// step event and stops each axis as its switch engages, or releases when leaving it. Runtime
+// commands are serviced while waiting. Returns the homing axis mask of the axes, which did not reach
+// their switch state within their travel. Check sys.abort afterwards.
 // NOTE: Only the abort runtime command can interrupt this process.
-static void homing_cycle(uint8_t cycle_mask, int8_t pos_dir, bool invert_pin, float homing_rate) 
+static uint8_t homing_motion(uint8_t cycle_mask, bool approach, float *travel, float homing_rate) 
 {
+  uint8_t limit_invert = 0;
+  if (approach) { limit_invert = LIMIT_MASK; } // Approaching axes stop when their pin reads active.
   #ifdef LIMIT_SWITCHES_ACTIVE_HIGH
-    // When in an active-high switch configuration, invert_pin needs to be adjusted.
-    invert_pin = !invert_pin;
+    // When in an active-high switch configuration, the pin state needs to be inverted.
+    limit_invert ^= LIMIT_MASK;
   #endif
 
-  // Determine governing axes with finest step resolution per distance for the Bresenham
-  // algorithm. This solves the issue when homing multiple axes that have different 
-  // resolutions without exceeding system acceleration setting. It doesn't have to be
-  // perfect since homing locates machine zero, but should create for a more consistent 
-  // and speedy homing routine.
-  // NOTE: For each axes enabled, the following calculations assume they physically move 
-  // an equal distance over each time step until they hit a limit switch, aka dogleg.
-  uint32_t steps[3];
-  uint8_t dist = 0;
-  clear_vector(steps);
-  if (cycle_mask & (1<<X_AXIS)) { 
-    dist++;
-    steps[X_AXIS] = lround(settings.steps_per_mm[X_AXIS]); 
-  }
-  if (cycle_mask & (1<<Y_AXIS)) { 
-    dist++;
-    steps[Y_AXIS] = lround(settings.steps_per_mm[Y_AXIS]); 
-  }
-  if (cycle_mask & (1<<Z_AXIS)) {
-    dist++;
-    steps[Z_AXIS] = lround(settings.steps_per_mm[Z_AXIS]);
+  // Switches are in the positive direction, unless inverted by the homing direction mask.
+  uint8_t direction_bit[N_AXIS] = { (1<<X_DIRECTION_BIT), (1<<Y_DIRECTION_BIT), (1<<Z_DIRECTION_BIT) };
+  float target[N_AXIS];
+  uint8_t idx;
+  sys_sync_current_position(); // Plan from where the last motion stopped.
+  for (idx=0; idx<N_AXIS; idx++) {
+    target[idx] = sys.position[idx]/settings.steps_per_mm[idx];
+    if (bit_istrue(cycle_mask,bit(idx))) {
+      if (bit_istrue(settings.homing_dir_mask,direction_bit[idx]) == approach) { target[idx] -= travel[idx]; }
+      else { target[idx] += travel[idx]; }
+    }
   }
-  uint32_t step_event_count = max(steps[X_AXIS], max(steps[Y_AXIS], steps[Z_AXIS]));  
-  
-  // To ensure global acceleration is not exceeded, reduce the governing axes nominal rate
-  // by adjusting the actual axes distance traveled per step. This is the same procedure
-  // used in the main planner to account for distance traveled when moving multiple axes.
-  // NOTE: When axis acceleration independence is installed, this will be updated to move
-  // all axes at their maximum acceleration and rate.
-  float ds = step_event_count/sqrt(dist);
-
-  // Compute the adjusted step rate change with each acceleration tick. (in step/min/acceleration_tick)
-  uint32_t delta_rate = ceil( ds*settings.acceleration/(60*ACCELERATION_TICKS_PER_SECOND));
-  
-  #ifdef HOMING_RATE_ADJUST
-    // Adjust homing rate so a multiple axes moves all at the homing rate independently.
-    homing_rate *= sqrt(dist); // Eq. only works if axes values are 1 or 0.
-  #endif
-  
-  // Nominal and initial time increment per step. Nominal should always be greater then 3
-  // usec, since they are based on the same parameters as the main stepper routine. Initial
-  // is based on the MINIMUM_STEPS_PER_MINUTE config. Since homing feed can be very slow,
-  // disable acceleration when rates are below MINIMUM_STEPS_PER_MINUTE.
-  uint32_t dt_min = lround(1000000*60/(ds*homing_rate)); // Cruising (usec/step)
-  uint32_t dt = 1000000*60/MINIMUM_STEPS_PER_MINUTE; // Initial (usec/step)
-  if (dt > dt_min) { dt = dt_min; } // Disable acceleration for very slow rates.
-      
-  // Set default out_bits. 
-  uint8_t out_bits0 = settings.invert_mask;
-  out_bits0 ^= (settings.homing_dir_mask & DIRECTION_MASK); // Apply homing direction settings
-  if (!pos_dir) { out_bits0 ^= DIRECTION_MASK; }   // Invert bits, if negative dir.
-  
-  // Initialize stepping variables
-  int32_t counter_x = -(step_event_count >> 1); // Bresenham counters
-  int32_t counter_y = counter_x;
-  int32_t counter_z = counter_x;
-  uint32_t step_delay = dt-settings.pulse_microseconds;  // Step delay after pulse
-  uint32_t step_rate = 0;  // Tracks step rate. Initialized from 0 rate. (in step/min)
-  uint32_t trap_counter = MICROSECONDS_PER_ACCELERATION_TICK/2; // Acceleration trapezoid counter
-  uint8_t out_bits;
-  uint8_t limit_state;
-  for(;;) {
+
+  st_set_homing_axes(homing_mask(cycle_mask), limit_invert);
+  plan_set_line_number(0); // Not a program line.
+  plan_buffer_line(target[X_AXIS], target[Y_AXIS], target[Z_AXIS], homing_rate, false);
+  st_wake_up();
   
-    // Reset out bits. Both direction and step pins appropriately inverted and set.
-    out_bits = out_bits0;
-    
-    // Get limit pin state.
-    limit_state = LIMIT_PIN;
-    if (invert_pin) { limit_state ^= LIMIT_MASK; } // If leaving switch, invert to move.
-    
-    // Set step pins by Bresenham line algorithm. If limit switch reached, disable and
-    // flag for completion.
-    if (cycle_mask & (1<<X_AXIS)) {
-      counter_x += steps[X_AXIS];
-      if (counter_x > 0) {
-        if (limit_state & (1<<X_LIMIT_BIT)) { out_bits ^= (1<<X_STEP_BIT); }
-        else { cycle_mask &= ~(1<<X_AXIS); }
-        counter_x -= step_event_count;
-      }
-    }
-    if (cycle_mask & (1<<Y_AXIS)) {
-      counter_y += steps[Y_AXIS];
-      if (counter_y > 0) {
-        if (limit_state & (1<<Y_LIMIT_BIT)) { out_bits ^= (1<<Y_STEP_BIT); }
-        else { cycle_mask &= ~(1<<Y_AXIS); }
-        counter_y -= step_event_count;
-      }
-    }
-    if (cycle_mask & (1<<Z_AXIS)) {
-      counter_z += steps[Z_AXIS];
-      if (counter_z > 0) {
-        if (limit_state & (1<<Z_LIMIT_BIT)) { out_bits ^= (1<<Z_STEP_BIT); }
-        else { cycle_mask &= ~(1<<Z_AXIS); }
-        counter_z -= step_event_count;
-      }
-    }        
-    
-    // Check if we are done or for system abort
-    if (!(cycle_mask) || (sys.execute & EXEC_RESET)) { return; }
-        
-    // Perform step.
-    STEPPING_PORT = (STEPPING_PORT & ~STEP_MASK) | (out_bits & STEP_MASK);
-    delay_us(settings.pulse_microseconds);
-    STEPPING_PORT = out_bits0;
-    delay_us(step_delay);
-    
-    // Track and set the next step delay, if required. This routine uses another Bresenham
-    // line algorithm to follow the constant acceleration line in the velocity and time 
-    // domain. This is a lite version of the same routine used in the main stepper program.
-    if (dt > dt_min) { // Unless cruising, check for time update.
-      trap_counter += dt; // Track time passed since last update.
-      if (trap_counter > MICROSECONDS_PER_ACCELERATION_TICK) {
-        trap_counter -= MICROSECONDS_PER_ACCELERATION_TICK;
-        step_rate += delta_rate; // Increment velocity
-        dt = (1000000*60)/step_rate; // Compute new time increment
-        if (dt < dt_min) {dt = dt_min;}  // If target rate reached, cruise.
-        step_delay = dt-settings.pulse_microseconds;
-      }
+  // Wait for the motion to stop, at the switches or at its full travel.
+  while (plan_get_current_block() != NULL) {
+    protocol_execute_runtime();
+    if (sys.abort) { break; } // Aborted. Alarm state set by mc_reset.
+  }
+  return(st_get_homing_axes());
+}
+
+// Moves all specified axes in parallel towards or away from their limit switches, each at its own
+// homing rate. Each axis travels in proportion to its rate, so the planned line moves every axis at
+// its rate, and the line lasts long enough for every axis to cover at least its travel. Returns
+// false, if an axis did not reach its switch state or the cycle was aborted.
+static uint8_t homing_cycle(uint8_t cycle_mask, bool approach, float *travel, float *axis_rate) 
+{
+  float travel_vector[N_AXIS];
+  float duration = 0.0; // min
+  float homing_rate = 0.0;
+  uint8_t idx;
+  for (idx=0; idx<N_AXIS; idx++) {
+    if (bit_istrue(cycle_mask,bit(idx))) {
+      duration = max(duration, travel[idx]/axis_rate[idx]);
+      homing_rate += axis_rate[idx]*axis_rate[idx];
     }
   }
+  for (idx=0; idx<N_AXIS; idx++) { travel_vector[idx] = duration*axis_rate[idx]; }
+  homing_rate = sqrt(homing_rate);
+
+  uint8_t missed = homing_motion(cycle_mask, approach, travel_vector, homing_rate);
+  return(!missed && !sys.abort);
+}
+
+// Quick search cycle from a parked position. Machine zero is where the switches release, and the
+// parked position lies on the far side, so each switch is expected at the parked distance from
+// zero. Moves the axes at the default seek rate to within HOMING_QUICK_WINDOW of their switches,
+// then searches across the window at the homing seek rate. Returns false, if a switch engages
+// before the window or is not found within it.
+static uint8_t quick_search_cycle(uint8_t cycle_mask, float *parked_position)
+{
+  float travel[N_AXIS];
+  uint8_t idx;
+  for (idx=0; idx<N_AXIS; idx++) {
+    travel[idx] = max(fabs(parked_position[idx])-HOMING_QUICK_WINDOW, 0.0);
+  }
+  if (homing_motion(cycle_mask, true, travel, settings.default_seek_rate) != homing_mask(cycle_mask)) { return(false); }
+  if (sys.abort) { return(false); }
+  for (idx=0; idx<N_AXIS; idx++) { travel[idx] = 2*HOMING_QUICK_WINDOW; }
+  return(homing_cycle(cycle_mask, true, travel, settings.homing_axis_seek_rate));
 }
 
 
 void limits_go_home() 
 {  
-  // Enable only the steppers, not the cycle. Cycle should be inactive/complete.
-  st_wake_up();
-  
-  // Search to engage all axes limit switches at faster homing seek rate.
-  homing_cycle(HOMING_SEARCH_CYCLE_0, true, false, settings.homing_seek_rate);  // Search cycle 0
-  #ifdef HOMING_SEARCH_CYCLE_1
-    homing_cycle(HOMING_SEARCH_CYCLE_1, true, false, settings.homing_seek_rate);  // Search cycle 1
-  #endif
-  #ifdef HOMING_SEARCH_CYCLE_2
-    homing_cycle(HOMING_SEARCH_CYCLE_2, true, false, settings.homing_seek_rate);  // Search cycle 2
-  #endif
-  delay_ms(settings.homing_debounce_delay); // Delay to debounce signal
-    
+  uint8_t homed = false;
+  float search_travel[N_AXIS], locate_travel[N_AXIS];
+  uint8_t idx;
+  for (idx=0; idx<N_AXIS; idx++) {
+    search_travel[idx] = HOMING_SEARCH_SCALAR*settings.max_travel[idx]; // Finds the switch from anywhere.
+    locate_travel[idx] = HOMING_LOCATE_TRAVEL;
+  }
+  debounce_start(); // Sample the limit pins throughout the cycle.
+  if (parked) {
+    // Quick search from the parked position, which is trusted as the machine position.
+    float parked_position[N_AXIS];
+    settings_read_coord_data(SETTING_INDEX_PARK, parked_position);
+    for (idx=0; idx<N_AXIS; idx++) { sys.position[idx] = lround(parked_position[idx]*settings.steps_per_mm[idx]); }
+    limits_unpark();
+    homed = quick_search_cycle(HOMING_SEARCH_CYCLE_0, parked_position);
+    #ifdef HOMING_SEARCH_CYCLE_1
+      if (homed) { homed = quick_search_cycle(HOMING_SEARCH_CYCLE_1, parked_position); }
+    #endif
+    #ifdef HOMING_SEARCH_CYCLE_2
+      if (homed) { homed = quick_search_cycle(HOMING_SEARCH_CYCLE_2, parked_position); }
+    #endif
+  }
+
+  if (!homed && !sys.abort) {
+    // Search to engage all axes limit switches at faster homing seek rates. Also the fallback, if
+    // the quick search did not find the switches where expected.
+    homed = homing_cycle(HOMING_SEARCH_CYCLE_0, true, search_travel, settings.homing_axis_seek_rate);  // Search cycle 0
+    #ifdef HOMING_SEARCH_CYCLE_1
+      if (homed) { homed = homing_cycle(HOMING_SEARCH_CYCLE_1, true, search_travel, settings.homing_axis_seek_rate); }  // Search cycle 1
+    #endif
+    #ifdef HOMING_SEARCH_CYCLE_2
+      if (homed) { homed = homing_cycle(HOMING_SEARCH_CYCLE_2, true, search_travel, settings.homing_axis_seek_rate); }  // Search cycle 2
+    #endif
+  }
+
   // Now in proximity of all limits. Carefully leave and approach switches in multiple cycles
-  // to precisely hone in on the machine zero location. Moves at slower homing feed rate.
+  // to precisely hone in on the machine zero location. Moves at slower homing feed rates.
   int8_t n_cycle = N_HOMING_LOCATE_CYCLE;
-  while (n_cycle--) {
+  while (homed && n_cycle--) {
     // Leave all switches to release them. After cycles complete, this is machine zero.
-    homing_cycle(HOMING_LOCATE_CYCLE, false, true, settings.homing_feed_rate);
-    delay_ms(settings.homing_debounce_delay);
+    // Each pass starts right away, since switch bounce is filtered by the debounce sampling.
+    homed = homing_cycle(HOMING_LOCATE_CYCLE, false, locate_travel, settings.homing_axis_feed_rate);
     
-    if (n_cycle > 0) {
+    if (homed && n_cycle > 0) {
       // Re-approach all switches to re-engage them.
-      homing_cycle(HOMING_LOCATE_CYCLE, true, false, settings.homing_feed_rate);
-      delay_ms(settings.homing_debounce_delay);
+      homed = homing_cycle(HOMING_LOCATE_CYCLE, true, locate_travel, settings.homing_axis_feed_rate);
     }
   }
 
-  st_go_idle(); // Call main stepper shutdown routine.  
+  if (!homed && !sys.abort) {
+    // A switch was not found. Lock out until homed again, since the position is unknown.
+    report_alarm_message(ALARM_HOMING_FAIL);
+    sys.state = STATE_ALARM;
+    mc_reset();
+  }
+
+  TCCR0B = 0; // Stop the debounce sampling. A later pin change restarts it.
+  st_go_idle(); // Call main stepper shutdown routine. Steppers stay enabled for the pull-off.
 }
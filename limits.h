@@ -35,4 +35,22 @@ void limits_init();
 // perform the homing cycle
 void limits_go_home();
 
+// Saves the trusted machine position as cleanly parked, for a quick re-home after power up
+void limits_park();
+
+// Clears the parked position before any motion
+void limits_unpark();
+
+// Returns the debounced limit pin levels, kept current by the debounce timer while homing
+uint8_t limits_get_state();
+
+// Returns true, if a parked position is stored
+uint8_t limits_is_parked();
+
+// Returns true, if the box in machine coordinates leaves the soft limits workspace envelope
+uint8_t limits_soft_exceeded(float *box_min, float *box_max);
+
+// Stops the machine in a controlled way upon a soft limit violation and sets the alarm state
+void limits_soft_alarm();
+
 #endif
\ No newline at end of file
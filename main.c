@@ -95,10 +95,12 @@ int main(void)
 		if (sys.abort) 
 		{
 	  		// Reset system.
+			serial_set_baud_rate(settings.baud_rate); // Apply a changed baud rate setting
 			serial_reset_read_buffer();	// Clear serial read buffer
 										// 清除串口接收缓冲区
 			plan_init();				// Clear block buffer and planner variables
 										// 清空预处理缓存区与相关变量
+			mc_init();					// Clear parsed motion queue
 			gc_init(); 					// Set g-code parser to default state
 										// 设置G代码解析器的默认状态
 			protocol_init(); 			// Clear incoming line data and execute startup lines
@@ -133,6 +135,7 @@ int main(void)
 			if (sys.state == STATE_ALARM) 
 			{
 				report_feedback_message(MESSAGE_ALARM_LOCK); 
+				if (limits_is_parked()) { report_feedback_message(MESSAGE_PARKED); }
 			} 
 			else 
 			{
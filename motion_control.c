@@ -46,6 +46,159 @@
 #include "limits.h"
 #include "protocol.h"
 
+// Parsed motion queue. Holds commands, already converted to absolute machine coordinates by the
+// g-code parser, that could not be placed because the planner buffer was full, along with any
+// spindle and coolant changes that must follow them in order. This lets the parser
+// keep reading and acknowledging lines ahead of the planner. Queued commands are moved into the
+// planner in order by mc_process_queue() as soon as blocks retire.
+#define MC_COMMAND_LINE       0 // Line motion
+#define MC_COMMAND_ACCESSORY  1 // Spindle and coolant state change
+#define MC_COMMAND_DWELL      2 // Timed dwell
+
+typedef struct {
+	uint8_t type;              // Command type. See MC_COMMAND defines.
+	float   target[N_AXIS];    // Absolute machine target in mm
+	float   feed_rate;         // Feed rate as passed to mc_line(). Dwell time in seconds for dwells.
+	uint8_t invert_feed_rate;  // Inverse time feed rate flag
+	int8_t  spindle_direction; // Spindle state for accessory commands. 1 = CW, -1 = CCW, 0 = Stop
+	uint8_t coolant_mode;      // Coolant state for accessory commands
+	uint16_t line_number;      // Line number of the source line for lines and dwells, low 16 bits
+} mc_command_t;
+
+static mc_command_t motion_queue[MOTION_QUEUE_SIZE];  // A ring buffer of parsed commands
+static uint8_t motion_queue_head;                     // Index of the next command to be pushed
+static uint8_t motion_queue_tail;                     // Index of the next command to be planned
+
+static int8_t  mc_spindle_direction;  // Last spindle state passed on by the parser
+static uint8_t mc_coolant_mode;       // Last coolant state passed on by the parser
+
+// Returns the index of the next command in the queue ring buffer
+static uint8_t next_queue_index(uint8_t index)
+{
+	index++;
+	if (index == MOTION_QUEUE_SIZE) { index = 0; }
+	return(index);
+}
+
+// Returns the free slot at the queue head, waiting until the planner retires a block and the queue
+// makes room, if it is full. The caller fills the slot and advances the head. Returns NULL upon
+// system abort.
+static mc_command_t *get_queue_slot()
+{
+	while (next_queue_index(motion_queue_head) == motion_queue_tail)
+	{
+		protocol_execute_runtime(); // Check for any run-time commands
+		if (sys.abort) { return(NULL); }  // Bail, if system abort.
+	}
+	return(&motion_queue[motion_queue_head]);
+}
+
+// Flags the system to run a newly planned block.
+static void mc_cycle_queued()
+{
+	// If idle, indicate to the system there is now a planned block in the buffer ready to cycle 
+	// start. Otherwise ignore and continue on.
+	if (!sys.state) { sys.state = STATE_QUEUED; }
+
+	// Auto-cycle start immediately after planner finishes. Enabled/disabled by grbl settings. During 
+	// a feed hold, auto-start is disabled momentarily until the cycle is resumed by the cycle-start 
+	// runtime command.
+	// NOTE: This is allows the user to decide to exclusively use the cycle start runtime command to
+	// begin motion or let grbl auto-start it for them. This is useful when: manually cycle-starting
+	// when the buffer is completely full and primed; auto-starting, if there was only one g-code 
+	// command sent during manual operation; or if a system is prone to buffer starvation, auto-start
+	// helps make sure it minimizes any dwelling/motion hiccups and keeps the cycle going. 
+	if (sys.auto_start) { st_cycle_start(); }
+}
+
+// Places a line motion into the planner and flags the system to run it. Assumes the planner
+// buffer is available. The block carries the line number for the status report.
+static void mc_plan_line(float x, float y, float z, float feed_rate, uint8_t invert_feed_rate, 
+                         uint16_t line_number)
+{
+	plan_set_line_number(line_number);
+	plan_buffer_line(x, y, z, feed_rate, invert_feed_rate);
+	mc_cycle_queued();
+}
+
+// Places a dwell into the planner and flags the system to run it. Assumes the planner buffer is
+// available.
+static void mc_plan_dwell(float seconds, uint16_t line_number)
+{
+	plan_set_line_number(line_number);
+	plan_buffer_dwell(seconds);
+	mc_cycle_queued();
+}
+
+// Waits for a running jog to finish, so program motions and state changes are never mixed into the
+// jog motions, where a jog cancel would discard them.
+static void mc_finish_jog()
+{
+	if (sys.state == STATE_JOG) { plan_synchronize(); }
+}
+
+// Clears the parsed motion queue. Called by the system abort routine, after the spindle and
+// coolant have been stopped.
+void mc_init()
+{
+	motion_queue_head = 0;
+	motion_queue_tail = 0;
+	mc_spindle_direction = 0;
+	mc_coolant_mode = COOLANT_DISABLE;
+}
+
+// Moves queued commands into the planner while there is room. Called from the runtime command
+// check points, so the queue drains whenever the main program waits on the planner or stepper.
+void mc_process_queue()
+{
+	while ((motion_queue_tail != motion_queue_head) && !plan_check_full_buffer())
+	{
+		mc_command_t *cmd = &motion_queue[motion_queue_tail];
+		if (cmd->type == MC_COMMAND_ACCESSORY)
+		{
+			plan_set_accessory_state(cmd->spindle_direction, cmd->coolant_mode);
+		}
+		else if (cmd->type == MC_COMMAND_DWELL)
+		{
+			mc_plan_dwell(cmd->feed_rate, cmd->line_number);
+		}
+		else
+		{
+			mc_plan_line(cmd->target[X_AXIS], cmd->target[Y_AXIS], cmd->target[Z_AXIS], 
+			             cmd->feed_rate, cmd->invert_feed_rate, cmd->line_number);
+		}
+		motion_queue_tail = next_queue_index(motion_queue_tail);
+	}
+}
+
+// Sets the spindle and coolant state for the motions that follow. The change is carried in the
+// motion stream and is applied by the stepper subsystem when the next planned block starts, or
+// when the buffer runs empty, rather than by stopping the machine to synchronize.
+void mc_set_accessory_state(int8_t spindle_direction, uint8_t coolant_mode)
+{
+	if ((spindle_direction == mc_spindle_direction) && (coolant_mode == mc_coolant_mode)) { return; }
+	mc_spindle_direction = spindle_direction;
+	mc_coolant_mode = coolant_mode;
+	mc_finish_jog();
+
+	// Keep the change in order behind any motions still waiting on the planner.
+	if (motion_queue_tail == motion_queue_head)
+	{
+		plan_set_accessory_state(spindle_direction, coolant_mode);
+	}
+	else
+	{
+		mc_command_t *cmd = get_queue_slot();
+		if (cmd == NULL) { return; }
+		cmd->type = MC_COMMAND_ACCESSORY;
+		cmd->spindle_direction = spindle_direction;
+		cmd->coolant_mode = coolant_mode;
+		motion_queue_head = next_queue_index(motion_queue_head);
+	}
+}
+
+static void mc_buffer_line(float x, float y, float z, float feed_rate, uint8_t invert_feed_rate);
+
 // Execute linear motion in absolute millimeter coordinates. Feed rate given in millimeters/second
 // unless invert_feed_rate is true. Then the feed_rate means that the motion should be completed in
 // (1 minute)/feed_rate time.
@@ -59,10 +212,21 @@
 // backlash segment(s).
 void mc_line(float x, float y, float z, float feed_rate, uint8_t invert_feed_rate)
 {
-	// TODO: Perform soft limit check here. Just check if the target x,y,z values are outside the 
-	// work envelope. Should be straightforward and efficient. By placing it here, rather than in 
-	// the g-code parser, it directly picks up motions from everywhere in Grbl.
+	// Check the target against the soft limits workspace envelope. By placing it here, rather than
+	// in the g-code parser, it directly picks up motions from everywhere in Grbl.
+	float target[N_AXIS] = { x, y, z };
+	if (limits_soft_exceeded(target, target))
+	{
+		limits_soft_alarm();
+		return;
+	}
+	mc_buffer_line(x, y, z, feed_rate, invert_feed_rate);
+}
 
+// Passes a line motion on to the planner, or the parsed motion queue if the planner is full. Does
+// not check the soft limits, so arcs and curves check their bounding box once for all segments.
+static void mc_buffer_line(float x, float y, float z, float feed_rate, uint8_t invert_feed_rate)
+{
 	// If in check gcode mode, prevent motion by blocking planner.
 	if (sys.state == STATE_CHECK_MODE) { return; }
 
@@ -73,27 +237,30 @@ void mc_line(float x, float y, float z, float feed_rate, uint8_t invert_feed_rat
 	// i.e. keep the planner independent and do the computations in the status reporting, or let
 	// the planner handle the position corrections. The latter may get complicated.
 
-	// If the buffer is full: good! That means we are well ahead of the robot. 
-	// Remain in this loop until there is room in the buffer.
-	do {
-		protocol_execute_runtime(); // Check for any run-time commands
-		if (sys.abort) { return; }  // Bail, if system abort.
-	} while ( plan_check_full_buffer() );
-	plan_buffer_line(x, y, z, feed_rate, invert_feed_rate);
+	protocol_execute_runtime(); // Check for any run-time commands. Also drains the motion queue.
+	if (sys.abort) { return; }  // Bail, if system abort.
+	mc_finish_jog();
 
-	// If idle, indicate to the system there is now a planned block in the buffer ready to cycle 
-	// start. Otherwise ignore and continue on.
-	if (!sys.state) { sys.state = STATE_QUEUED; }
+	// Plan directly when nothing is waiting ahead of this motion and there is room in the buffer.
+	if ((motion_queue_tail == motion_queue_head) && !plan_check_full_buffer())
+	{
+		mc_plan_line(x, y, z, feed_rate, invert_feed_rate, gc.line_number);
+		return;
+	}
 
-	// Auto-cycle start immediately after planner finishes. Enabled/disabled by grbl settings. During 
-	// a feed hold, auto-start is disabled momentarily until the cycle is resumed by the cycle-start 
-	// runtime command.
-	// NOTE: This is allows the user to decide to exclusively use the cycle start runtime command to
-	// begin motion or let grbl auto-start it for them. This is useful when: manually cycle-starting
-	// when the buffer is completely full and primed; auto-starting, if there was only one g-code 
-	// command sent during manual operation; or if a system is prone to buffer starvation, auto-start
-	// helps make sure it minimizes any dwelling/motion hiccups and keeps the cycle going. 
-	if (sys.auto_start) { st_cycle_start(); }
+	// If the buffer is full: good! That means we are well ahead of the robot. Park the motion in the
+	// parsed motion queue and return to the parser. Only when the queue is also full, remain in a
+	// loop until the planner retires a block and the queue makes room.
+	mc_command_t *cmd = get_queue_slot();
+	if (cmd == NULL) { return; }
+	cmd->type = MC_COMMAND_LINE;
+	cmd->target[X_AXIS] = x;
+	cmd->target[Y_AXIS] = y;
+	cmd->target[Z_AXIS] = z;
+	cmd->feed_rate = feed_rate;
+	cmd->invert_feed_rate = invert_feed_rate;
+	cmd->line_number = gc.line_number;
+	motion_queue_head = next_queue_index(motion_queue_head);
 }
 
 
@@ -101,8 +268,9 @@ void mc_line(float x, float y, float z, float feed_rate, uint8_t invert_feed_rat
 // offset == offset from current xyz, axis_XXX defines circle plane in tool space, axis_linear is
 // the direction of helical travel, radius == circle radius, isclockwise boolean. Used for vector
 // transformation direction.
-// The arc is approximated by generating a huge number of tiny, linear segments. The length of each 
-// segment is configured in settings.mm_per_arc_segment.
+// The arc is approximated by generating a huge number of tiny, linear segments. The number of
+// segments is computed from settings.arc_tolerance, the maximum allowed deviation between each
+// chord and the true arc, and clamped by the arc segmentation limits in config.h.
 // position: 起点坐标  target:终点坐标  offset:圆心坐标(圆内相对)
 void mc_arc(float *position, float *target, float *offset, uint8_t axis_0, uint8_t axis_1, 
    uint8_t axis_linear, float feed_rate, uint8_t invert_feed_rate, float radius, uint8_t isclockwise)
@@ -133,8 +301,55 @@ void mc_arc(float *position, float *target, float *offset, uint8_t axis_0, uint8
 
 	float millimeters_of_travel = hypot(angular_travel*radius, fabs(linear_travel));
 	if (millimeters_of_travel == 0.0) { return; }
-	// floor(): Returns the largest integral value less than or equal floor().
-	uint16_t segments = floor(millimeters_of_travel/settings.mm_per_arc_segment);
+
+	// Check the bounding box of the whole arc against the soft limits, rather than each segment. The
+	// box spans the end points and each quadrant point of the circle, which the arc passes.
+	float box_min[N_AXIS], box_max[N_AXIS];
+	uint8_t idx;
+	for (idx=0; idx<N_AXIS; idx++)
+	{
+		box_min[idx] = min(position[idx], target[idx]);
+		box_max[idx] = max(position[idx], target[idx]);
+	}
+	float start_angle = atan2(r_axis1, r_axis0);
+	for (idx=0; idx<4; idx++)
+	{
+		// Angle the arc sweeps from its start to the quadrant point at idx*90 degrees from axis_0.
+		float sweep = idx*0.5*M_PI - start_angle;
+		if (isclockwise) { sweep = -sweep; }
+		sweep = fmod(sweep, 2*M_PI);
+		if (sweep < 0) { sweep += 2*M_PI; }
+		if (sweep < fabs(angular_travel))
+		{
+			switch (idx)
+			{
+				case 0: box_max[axis_0] = max(box_max[axis_0], center_axis0+radius); break;
+				case 1: box_max[axis_1] = max(box_max[axis_1], center_axis1+radius); break;
+				case 2: box_min[axis_0] = min(box_min[axis_0], center_axis0-radius); break;
+				case 3: box_min[axis_1] = min(box_min[axis_1], center_axis1-radius); break;
+			}
+		}
+	}
+	if (limits_soft_exceeded(box_min, box_max))
+	{
+		limits_soft_alarm();
+		return;
+	}
+
+	// Compute the segment count from the chord tolerance. A chord spanning angle theta deviates at most
+	// r*(1-cos(theta/2)) from the arc, so the half chord for a deviation of arc_tolerance is
+	// sqrt(tol*(2r-tol)). Rounding the count up guarantees the tolerance is never exceeded. Radii at or
+	// below half the tolerance fit within a single chord and are left to the floor limit.
+	// ceil(): Returns the smallest integral value greater than or equal ceil().
+	float segments_f = 1.0;
+	float half_chord_sq = settings.arc_tolerance*(2*radius - settings.arc_tolerance);
+	if (half_chord_sq > 0.0) { segments_f = ceil(fabs(0.5*angular_travel*radius)/sqrt(half_chord_sq)); }
+	// Floor: never span more than ARC_MAX_ANGLE_PER_SEGMENT. Ceiling: never go below ARC_MIN_SEGMENT_LENGTH.
+	segments_f = max(segments_f, ceil(fabs(angular_travel)/ARC_MAX_ANGLE_PER_SEGMENT));
+	segments_f = min(segments_f, floor(millimeters_of_travel/ARC_MIN_SEGMENT_LENGTH));
+	if (segments_f < 1.0) { segments_f = 1.0; }
+	if (segments_f > 0xffff) { segments_f = 0xffff; }
+	uint16_t segments = segments_f;
 	// Multiply inverse feed_rate to compensate for the fact that this movement is approximated
 	// by a number of discrete segments. The inverse feed_rate should be correct for the sum of 
 	// all segments.
@@ -157,12 +372,16 @@ void mc_arc(float *position, float *target, float *offset, uint8_t axis_0, uint8
 	tool precision in some cases. Therefore, arc path correction is implemented. 
 
 	Small angle approximation may be used to reduce computation overhead further. This approximation
-	holds for everything, but very small circles and large mm_per_arc_segment values. In other words,
+	holds for everything, but very small circles and large arc tolerance values. In other words,
 	theta_per_segment would need to be greater than 0.1 rad and N_ARC_CORRECTION would need to be large
 	to cause an appreciable drift error. N_ARC_CORRECTION~=25 is more than small enough to correct for 
 	numerical drift error. N_ARC_CORRECTION may be on the order a hundred(s) before error becomes an
 	issue for CNC machines with the single precision Arduino calculations.
 
+	ARC_MAX_ANGLE_PER_SEGMENT normally keeps theta_per_segment at or below 0.1 rad. The angle limit
+	yields to the minimum segment length, though: ARC_MIN_SEGMENT_LENGTH is applied after the angle
+	ceiling, so on very small radii the segments may span a larger angle than ARC_MAX_ANGLE_PER_SEGMENT.
+
 	This approximation also allows mc_arc to immediately insert a line segment into the planner 
 	without the initial overhead of computing cos() or sin(). By the time the arc needs to be applied
 	a correction, the planner should have caught up to the lag caused by the initial mc_arc overhead. 
@@ -207,31 +426,175 @@ void mc_arc(float *position, float *target, float *offset, uint8_t axis_0, uint8
 		arc_target[axis_0] = center_axis0 + r_axis0;
 		arc_target[axis_1] = center_axis1 + r_axis1;
 		arc_target[axis_linear] += linear_per_segment;
-		mc_line(arc_target[X_AXIS], arc_target[Y_AXIS], arc_target[Z_AXIS], feed_rate, invert_feed_rate);
+		mc_buffer_line(arc_target[X_AXIS], arc_target[Y_AXIS], arc_target[Z_AXIS], feed_rate, invert_feed_rate);
 
-		// Bail mid-circle on system abort. Runtime command check already performed by mc_line.
+		// Bail mid-circle on system abort. Runtime command check already performed by mc_buffer_line.
 		if (sys.abort) { return; }
 	}
 	// Ensure last segment arrives at target location.
-	mc_line(target[X_AXIS], target[Y_AXIS], target[Z_AXIS], feed_rate, invert_feed_rate);
+	mc_buffer_line(target[X_AXIS], target[Y_AXIS], target[Z_AXIS], feed_rate, invert_feed_rate);
 }
 
 
-// Execute dwell in seconds.
-void mc_dwell(float seconds) 
+// Execute a cubic Bezier spline in the XY plane, given by the current position, the two control
+// points, and the target. Z travels linearly with the curve parameter. The curve is flattened into
+// line segments while walking the curve parameter t with an adaptive step:
+//   - Chord tolerance. The deviation of a chord spanning dt from the curve is at most 
+//     dt^2/8*max|B''|. Since B''(t) is linear in t, its maximum over the step is at one of the two
+//     ends, so the step is sized from the larger one to stay within the arc tolerance setting.
+//     Segments are short where the curve bends sharply and long where it is nearly straight.
+//   - Tangent continuity. The tangent turns at most ARC_MAX_ANGLE_PER_SEGMENT per segment, so all
+//     internal junctions stay nearly straight and the planner keeps them at full speed.
+//   - ARC_MIN_SEGMENT_LENGTH floors the step, measured along the control polygon, which bounds the
+//     segment count for degenerate control points. It takes precedence, as with arcs.
+void mc_bezier(float *position, float *target, float *first_control, float *second_control,
+  float feed_rate, uint8_t invert_feed_rate)
 {
-	uint16_t i = floor(1000/DWELL_TIME_STEP*seconds);
-	plan_synchronize();
-	delay_ms(floor(1000*seconds-i*DWELL_TIME_STEP)); // Delay millisecond remainder
-	while (i-- > 0) {
-		// NOTE: Check and execute runtime commands during dwell every <= DWELL_TIME_STEP milliseconds.
-		protocol_execute_runtime();
+	float p0[2], p1[2], p2[2], p3[2];  // Control polygon
+	float d0[2], d1[2];                // Second derivative at t = 0 and t = 1, divided by 6
+	uint8_t k;
+	for (k = 0; k < 2; k++)
+	{
+		p0[k] = position[k];
+		p1[k] = first_control[k];
+		p2[k] = second_control[k];
+		p3[k] = target[k];
+		d0[k] = p0[k] - 2*p1[k] + p2[k];
+		d1[k] = p1[k] - 2*p2[k] + p3[k];
+	}
+	float linear_travel = target[Z_AXIS] - position[Z_AXIS];
+	float polygon_length = hypot(p1[X_AXIS]-p0[X_AXIS], p1[Y_AXIS]-p0[Y_AXIS]) +
+	                       hypot(p2[X_AXIS]-p1[X_AXIS], p2[Y_AXIS]-p1[Y_AXIS]) +
+	                       hypot(p3[X_AXIS]-p2[X_AXIS], p3[Y_AXIS]-p2[Y_AXIS]);
+
+	// The curve length lies between the chord and the control polygon lengths. Their mean is used
+	// to convert an inverse time feed rate for the whole curve into a feed rate for the segments.
+	if (invert_feed_rate)
+	{
+		float chord_length = hypot(p3[X_AXIS]-p0[X_AXIS], p3[Y_AXIS]-p0[Y_AXIS]);
+		feed_rate *= hypot(0.5*(chord_length+polygon_length), linear_travel);
+		invert_feed_rate = false;
+	}
+	if (polygon_length == 0.0)
+	{
+		mc_line(target[X_AXIS], target[Y_AXIS], target[Z_AXIS], feed_rate, invert_feed_rate);
+		return;
+	}
+
+	// Check the soft limits once for the whole curve. The curve lies within the bounding box of its
+	// control polygon, and Z travels linearly.
+	float box_min[N_AXIS], box_max[N_AXIS];
+	for (k = 0; k < 2; k++)
+	{
+		box_min[k] = min(min(p0[k], p1[k]), min(p2[k], p3[k]));
+		box_max[k] = max(max(p0[k], p1[k]), max(p2[k], p3[k]));
+	}
+	box_min[Z_AXIS] = min(position[Z_AXIS], target[Z_AXIS]);
+	box_max[Z_AXIS] = max(position[Z_AXIS], target[Z_AXIS]);
+	if (limits_soft_exceeded(box_min, box_max))
+	{
+		limits_soft_alarm();
+		return;
+	}
+
+	float dt_min = ARC_MIN_SEGMENT_LENGTH/polygon_length;
+	float curve_target[3];
+	float t = 0.0;
+	float dt, u, accel, accel_end;
+	float speed;
+	for (;;)
+	{
+		// |B'(t)| and |B''(t)| at the start of the step
+		u = 1.0-t;
+		speed = 3*hypot(u*u*(p1[X_AXIS]-p0[X_AXIS]) + 2*u*t*(p2[X_AXIS]-p1[X_AXIS]) + t*t*(p3[X_AXIS]-p2[X_AXIS]),
+		                u*u*(p1[Y_AXIS]-p0[Y_AXIS]) + 2*u*t*(p2[Y_AXIS]-p1[Y_AXIS]) + t*t*(p3[Y_AXIS]-p2[Y_AXIS]));
+		accel = 6*hypot(u*d0[X_AXIS] + t*d1[X_AXIS], u*d0[Y_AXIS] + t*d1[Y_AXIS]);
+
+		dt = u;
+		if (accel > 0.0)
+		{
+			dt = min(dt, sqrt(8*settings.arc_tolerance/accel));
+			// Recheck against the second derivative at the far end of the step.
+			u = 1.0-(t+dt);
+			accel_end = 6*hypot(u*d0[X_AXIS] + (t+dt)*d1[X_AXIS], u*d0[Y_AXIS] + (t+dt)*d1[Y_AXIS]);
+			accel = max(accel, accel_end);
+			dt = min(dt, sqrt(8*settings.arc_tolerance/accel));
+			// Limit the tangent turn per segment. Turn rate is at most |B''|/|B'| radians per unit t.
+			dt = min(dt, ARC_MAX_ANGLE_PER_SEGMENT*speed/accel);
+		}
+		dt = max(dt, dt_min);
+
+		t += dt;
+		if (t >= 1.0) { break; }
+
+		u = 1.0-t;
+		for (k = 0; k < 2; k++)
+		{
+			curve_target[k] = u*u*u*p0[k] + 3*u*u*t*p1[k] + 3*u*t*t*p2[k] + t*t*t*p3[k];
+		}
+		curve_target[Z_AXIS] = position[Z_AXIS] + t*linear_travel;
+		mc_buffer_line(curve_target[X_AXIS], curve_target[Y_AXIS], curve_target[Z_AXIS], feed_rate, invert_feed_rate);
+
+		// Bail mid-curve on system abort. Runtime command check already performed by mc_buffer_line.
 		if (sys.abort) { return; }
-		_delay_ms(DWELL_TIME_STEP); // Delay DWELL_TIME_STEP increment
 	}
+	// Ensure last segment arrives at target location.
+	mc_buffer_line(target[X_AXIS], target[Y_AXIS], target[Z_AXIS], feed_rate, invert_feed_rate);
+}
+
+
+// Execute dwell in seconds. The dwell is buffered like a motion and timed by the stepper
+// subsystem once the preceding motions complete, so the parser does not wait on it.
+void mc_dwell(float seconds) 
+{
+	protocol_execute_runtime();
+	if (sys.abort) { return; }
+	mc_finish_jog();
+
+	if ((motion_queue_tail == motion_queue_head) && !plan_check_full_buffer())
+	{
+		mc_plan_dwell(seconds, gc.line_number);
+		return;
+	}
+
+	// Keep the dwell in order behind any motions still waiting on the planner.
+	mc_command_t *cmd = get_queue_slot();
+	if (cmd == NULL) { return; }
+	cmd->type = MC_COMMAND_DWELL;
+	cmd->feed_rate = seconds;
+	cmd->line_number = gc.line_number;
+	motion_queue_head = next_queue_index(motion_queue_head);
 }
 
 
+// Plans a jog motion to the target in absolute millimeters and starts it right away, regardless
+// of the auto start setting. Jog motions run in the jog state, bypassing the parsed motion queue,
+// so a jog cancel only has to discard the planner buffer to stop within the current plan. Returns
+// false if the motion was dropped, because the jog was cancelled while waiting for buffer room.
+uint8_t mc_jog(float *target, float feed_rate)
+{
+	protocol_execute_runtime(); // Also completes a jog that just finished.
+	if (sys.abort) { return(false); }
+	uint8_t jogging = (sys.state == STATE_JOG);
+	while (plan_check_full_buffer())
+	{
+		protocol_execute_runtime();
+		if (sys.abort) { return(false); }
+	}
+	// A full buffer only drains while the jog is running, so any other state here is a cancel.
+	if (jogging && sys.state != STATE_JOG) { return(false); }
+
+	plan_set_line_number(0); // Not a program line.
+	plan_buffer_line(target[X_AXIS], target[Y_AXIS], target[Z_AXIS], feed_rate, false);
+	if (sys.state == STATE_IDLE)
+	{
+		limits_unpark();
+		sys.state = STATE_JOG;
+		st_wake_up();
+	}
+	return(true);
+}
+
 // Perform homing cycle to locate and set machine zero. Only '$H' executes this command.
 // NOTE: There should be no motions in the buffer and Grbl must be in an idle state before
 // executing the homing cycle. This prevents incorrect buffered plans after homing.
@@ -239,6 +602,7 @@ void mc_go_home()
 {
 	sys.state = STATE_HOMING;   // Set system state variable
 	LIMIT_PCMSK &= ~LIMIT_MASK; // Disable hard limits pin change register for cycle duration
+	sys.homed = false;
 
 	limits_go_home();           // Perform homing routine.
 
@@ -249,30 +613,38 @@ void mc_go_home()
 	// reset system position and sync internal position vectors.
 	clear_vector_float(sys.position); // Set machine zero
 	sys_sync_current_position();
+	sys.homed = true;
 	sys.state = STATE_IDLE;     // Set system state to IDLE to complete motion and indicate homed.
 
 	// Pull-off axes (that have been homed) from limit switches before continuing motion. 
 	// This provides some initial clearance off the switches and should also help prevent them 
-	// from falsely tripping when hard limits are enabled.
-	int8_t x_dir, y_dir, z_dir;
-	x_dir = y_dir = z_dir = 0;
-	if (HOMING_LOCATE_CYCLE & (1<<X_AXIS))
-	{ 
-		if (settings.homing_dir_mask & (1<<X_DIRECTION_BIT)) { x_dir = 1; }
-		else { x_dir = -1; }
-	}
-	if (HOMING_LOCATE_CYCLE & (1<<Y_AXIS))
-	{ 
-		if (settings.homing_dir_mask & (1<<Y_DIRECTION_BIT)) { y_dir = 1; }
-		else { y_dir = -1; }
+	// from falsely tripping when hard limits are enabled. Each axis pulls off its own distance, at
+	// the highest rate which keeps every axis within its homing seek rate.
+	uint8_t direction_bit[N_AXIS] = { (1<<X_DIRECTION_BIT), (1<<Y_DIRECTION_BIT), (1<<Z_DIRECTION_BIT) };
+	float pulloff[N_AXIS];
+	float pulloff_length = 0.0;
+	float pulloff_rate = 0.0;
+	uint8_t idx;
+	for (idx=0; idx<N_AXIS; idx++)
+	{
+		pulloff[idx] = 0.0;
+		if (bit_istrue(HOMING_LOCATE_CYCLE,bit(idx)))
+		{ 
+			pulloff[idx] = settings.homing_axis_pulloff[idx];
+			if (bit_isfalse(settings.homing_dir_mask,direction_bit[idx])) { pulloff[idx] = -pulloff[idx]; }
+			pulloff_length += pulloff[idx]*pulloff[idx];
+		}
 	}
-	if (HOMING_LOCATE_CYCLE & (1<<Z_AXIS))
-	{ 
-		if (settings.homing_dir_mask & (1<<Z_DIRECTION_BIT)) { z_dir = 1; }
-		else { z_dir = -1; }
+	pulloff_length = sqrt(pulloff_length);
+	for (idx=0; idx<N_AXIS; idx++)
+	{
+		if (pulloff[idx] != 0.0)
+		{
+			float rate = settings.homing_axis_seek_rate[idx]*pulloff_length/fabs(pulloff[idx]);
+			if (pulloff_rate == 0.0 || rate < pulloff_rate) { pulloff_rate = rate; }
+		}
 	}
-	mc_line(x_dir*settings.homing_pulloff, y_dir*settings.homing_pulloff, 
-	      z_dir*settings.homing_pulloff, settings.homing_seek_rate, false);
+	mc_line(pulloff[X_AXIS], pulloff[Y_AXIS], pulloff[Z_AXIS], pulloff_rate, false);
 	st_cycle_start();   // Move it. Nothing should be in the buffer except this motion. 
 	plan_synchronize(); // Make sure the motion completes.
 
@@ -307,8 +679,9 @@ void mc_reset()
 		// violated, by which, all bets are off.
 		switch (sys.state)
 		{
-			case STATE_CYCLE: case STATE_HOLD: case STATE_HOMING: // case STATE_JOG:
+			case STATE_CYCLE: case STATE_HOLD: case STATE_HOMING: case STATE_JOG:
 				sys.execute |= EXEC_ALARM; // Execute alarm state.
+				sys.homed = false;
 				st_go_idle(); // Execute alarm force kills steppers. Position likely lost.
 		}
 	}
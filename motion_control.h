@@ -33,9 +33,23 @@
 #include <avr/io.h>
 #include "planner.h"
 
+// The number of parsed line motions that can wait for room in the planner buffer.
+#ifndef MOTION_QUEUE_SIZE
+  #define MOTION_QUEUE_SIZE 2
+#endif
+
+// Initialize the motion control subsystem. Clears any queued motions.
+void mc_init();
+
+// Moves parsed motions waiting in the motion queue into the planner buffer, if room is available.
+void mc_process_queue();
+
+// Sets the spindle and coolant state, applied in sequence with the buffered motions.
+void mc_set_accessory_state(int8_t spindle_direction, uint8_t coolant_mode);
+
 // Execute linear motion in absolute millimeter coordinates. Feed rate given in millimeters/second
 // unless invert_feed_rate is true. Then the feed_rate means that the motion should be completed in
-// (1 minute)/feed_rate time.
+// (1 minute)/feed_rate time. If the planner buffer is full, the motion is queued and planned later.
 void mc_line(float x, float y, float z, float feed_rate, uint8_t invert_feed_rate);
 
 // Execute an arc in offset mode format. position == current xyz, target == target xyz, 
@@ -45,9 +59,17 @@ void mc_line(float x, float y, float z, float feed_rate, uint8_t invert_feed_rat
 void mc_arc(float *position, float *target, float *offset, uint8_t axis_0, uint8_t axis_1,
   uint8_t axis_linear, float feed_rate, uint8_t invert_feed_rate, float radius, uint8_t isclockwise);
   
+// Execute a cubic Bezier spline in the XY plane. position == current xyz, target == target xyz,
+// first_control and second_control == absolute xy control points. Z travels linearly.
+void mc_bezier(float *position, float *target, float *first_control, float *second_control,
+  float feed_rate, uint8_t invert_feed_rate);
+
 // Dwell for a specific number of seconds
 void mc_dwell(float seconds);
 
+// Plans a jog motion in absolute millimeters and starts it. Returns false, if cancelled meanwhile.
+uint8_t mc_jog(float *target, float feed_rate);
+
 // Perform homing cycle to locate machine zero. Requires limit switches.
 void mc_go_home();
 
@@ -88,7 +88,7 @@
 #define STATE_ALARM      6 // In alarm state. Locks out all g-code processes. Allows settings access.
 #define STATE_CHECK_MODE 7 // G-code check mode. Locks out planner and motion only. (Locks out在...之外)
                            // G代码检查模式.只运动不执行预处理
-// #define STATE_JOG     8 // Jogging mode is unique like homing.
+#define STATE_JOG        8 // Jogging mode is unique like homing. Runs $J= motions, cancelled by feed hold.
 
 // Define global system variables
 typedef struct {
@@ -103,6 +103,8 @@ typedef struct {
 	                               // 以步的方式表示机床时实位置向量.当出现问题时需要一个易变的数值
 	uint8_t  auto_start;           // Planner auto-start flag. Toggled off during feed hold. Defaulted by settings.
 	                               // 预处理器自动启动标志,当暂停时关掉预处理器.默认状态由settings设置
+	uint8_t  jog_cancel;           // Feed hold in jog state. Remaining jog motions are discarded once stopped.
+	uint8_t  homed;                // Position trusted. Homed since power up and no motion killed since.
 } system_t;
 extern system_t sys;
 
@@ -0,0 +1,185 @@
+/*
+	packet.c - binary motion packet protocol
+	Part of Grbl
+
+	The MIT License (MIT)
+
+	GRBL(tm) - Embedded CNC g-code interpreter and motion-controller
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+	THE SOFTWARE.
+*/
+
+#include <util/crc16.h>
+#include "packet.h"
+#include "protocol.h"
+#include "gcode.h"
+#include "motion_control.h"
+#include "settings.h"
+#include "report.h"
+#include "nuts_bolts.h"
+#include "serial.h"
+
+typedef struct {
+	uint8_t enabled;                // True while in packet mode
+	uint8_t frame[PACKET_BUFFER_SIZE]; // Unstuffed bytes of the frame being received
+	uint8_t count;                  // Number of bytes in frame
+	uint8_t escaped;                // True when the previous byte was PACKET_ESC
+	uint8_t overflow;               // True when the frame being received is too long
+	int32_t position[N_AXIS];       // Last commanded position in work coordinates (um)
+} packet_t;
+static packet_t pk;
+
+static void packet_reset_frame()
+{
+	pk.count = 0;
+	pk.escaped = false;
+	pk.overflow = false;
+}
+
+void packet_init()
+{
+	pk.enabled = false;
+	serial_set_raw_mode(false);
+	packet_reset_frame();
+}
+
+// Enters packet mode. Relative packets continue from the current parser position.
+void packet_enable()
+{
+	uint8_t i;
+	for (i=0; i<N_AXIS; i++)
+	{
+		pk.position[i] = lround(1000*(gc.position[i]-gc.coord_system[i]-gc.coord_offset[i]));
+	}
+	packet_reset_frame();
+	pk.enabled = true;
+	serial_set_raw_mode(true);
+}
+
+uint8_t packet_enabled()
+{
+	return(pk.enabled);
+}
+
+// Moves to the commanded position in work coordinates and keeps the g-code parser position in
+// sync, so g-code lines after packet mode continue from here.
+static void packet_move(float feed_rate)
+{
+	uint8_t i;
+	for (i=0; i<N_AXIS; i++)
+	{
+		gc.position[i] = 0.001*pk.position[i] + gc.coord_system[i] + gc.coord_offset[i];
+	}
+	mc_line(gc.position[X_AXIS], gc.position[Y_AXIS], gc.position[Z_AXIS], feed_rate, false);
+}
+
+// Validates and executes a complete, unstuffed frame. Returns a status code like gc_execute_line().
+static uint8_t packet_execute()
+{
+	if (pk.overflow) { return(STATUS_OVERFLOW); }
+	if (pk.count < 2) { return(STATUS_PACKET_ERROR); }
+
+	// The CRC over the data and its appended CRC byte is zero for an intact frame.
+	uint8_t crc = 0;
+	uint8_t i;
+	for (i=0; i<pk.count; i++) { crc = _crc_ibutton_update(crc, pk.frame[i]); }
+	if (crc) { return(STATUS_PACKET_ERROR); }
+
+	uint8_t payload = pk.count-2;
+	uint8_t *data = &pk.frame[1];
+	switch (pk.frame[0])
+	{
+		case PACKET_OP_LINE: case PACKET_OP_SEEK:
+			if (payload != 3*sizeof(int32_t)) { return(STATUS_PACKET_ERROR); }
+			if (sys.state == STATE_ALARM) { return(STATUS_ALARM_LOCK); }
+			if (pk.frame[0] == PACKET_OP_LINE && gc.inverse_feed_rate_mode) { return(STATUS_INVALID_STATEMENT); }
+			memcpy(pk.position, data, 3*sizeof(int32_t));
+			packet_move((pk.frame[0] == PACKET_OP_SEEK) ? settings.default_seek_rate : gc.feed_rate);
+			break;
+		case PACKET_OP_LINE_REL:
+			if (payload != 3*sizeof(int16_t)) { return(STATUS_PACKET_ERROR); }
+			if (sys.state == STATE_ALARM) { return(STATUS_ALARM_LOCK); }
+			if (gc.inverse_feed_rate_mode) { return(STATUS_INVALID_STATEMENT); } // Feed is not in mm/min
+			{
+				int16_t offset[3];
+				memcpy(offset, data, sizeof(offset));
+				for (i=0; i<N_AXIS; i++) { pk.position[i] += offset[i]; }
+			}
+			packet_move(gc.feed_rate);
+			break;
+		case PACKET_OP_FEED:
+			if (payload != sizeof(float)) { return(STATUS_PACKET_ERROR); }
+			{
+				float feed_rate;
+				memcpy(&feed_rate, data, sizeof(float));
+				if (feed_rate <= 0) { return(STATUS_INVALID_STATEMENT); } // Must be greater than zero
+				gc.feed_rate = feed_rate;
+			}
+			break;
+		case PACKET_OP_DWELL:
+			if (payload != sizeof(float)) { return(STATUS_PACKET_ERROR); }
+			if (sys.state == STATE_ALARM) { return(STATUS_ALARM_LOCK); }
+			{
+				float seconds;
+				memcpy(&seconds, data, sizeof(float));
+				if (seconds < 0) { return(STATUS_INVALID_STATEMENT); } // Time cannot be negative.
+				if (sys.state != STATE_CHECK_MODE) { mc_dwell(seconds); }
+			}
+			break;
+		case PACKET_OP_EXIT:
+			if (payload != 0) { return(STATUS_PACKET_ERROR); }
+			pk.enabled = false;
+			serial_set_raw_mode(false);
+			break;
+		default:
+			return(STATUS_PACKET_ERROR);
+	}
+	return(STATUS_OK);
+}
+
+// Collects a frame from the received bytes, removing the byte stuffing. A complete frame is
+// executed and answered with a status message, just like a line in protocol_process().
+void packet_read_byte(uint8_t data)
+{
+	if (data == PACKET_END)
+	{
+		if (pk.count == 0 && !pk.overflow) { return; } // Ignore empty frames. Used to resync.
+
+		// Runtime command check point before executing the frame.
+		protocol_execute_runtime();
+		if (sys.abort) { return; }  // Bail to main program upon system abort
+
+		report_status_message(packet_execute());
+		packet_reset_frame();
+	}
+	else if (data == PACKET_ESC)
+	{
+		pk.escaped = true;
+	}
+	else
+	{
+		if (pk.escaped)
+		{
+			data ^= PACKET_ESC_XOR;
+			pk.escaped = false;
+		}
+		if (pk.count < PACKET_BUFFER_SIZE) { pk.frame[pk.count++] = data; }
+		else { pk.overflow = true; }
+	}
+}
@@ -0,0 +1,80 @@
+/*
+	packet.h - binary motion packet protocol
+	Part of Grbl
+
+	The MIT License (MIT)
+
+	GRBL(tm) - Embedded CNC g-code interpreter and motion-controller
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+	THE SOFTWARE.
+*/
+
+/*
+	Binary motion packets are an optional, compact alternative to g-code lines for streaming dense
+	toolpaths. Packet mode is entered with the '$B' command and left with an exit packet or a reset.
+	Each packet is a pre-tokenized motion record that is passed directly to the motion control
+	functions, bypassing the line filter and g-code parser.
+
+	Framing: [opcode][payload][crc][PACKET_END]. The crc is the 8-bit Dallas/Maxim CRC of the opcode
+	and payload (util/crc16.h _crc_ibutton_update). Any frame byte equal to PACKET_END, PACKET_ESC,
+	SERIAL_NO_DATA (0xff), or one of the runtime command characters is sent as PACKET_ESC followed
+	by the byte XOR PACKET_ESC_XOR. Runtime commands therefore keep working in packet mode, since
+	they never appear in a frame. Multi-byte values are little-endian. Every frame is answered with
+	'ok' or 'error:', exactly like a g-code line, so the same streaming flow control applies.
+
+	The serial receive interrupt filters g-code lines, but stores raw bytes in packet mode. The mode
+	changes when the '$B' line or the exit packet is executed, so the host must wait for their 'ok'
+	before sending packets or g-code lines, respectively.
+
+	Coordinates are in micrometers in the current work coordinate system, independent of G20/G21
+	and G90/G91. Feed rates are always in mm/min. Feed moves are therefore rejected while G93 inverse
+	time mode is active, and inverse time motions must be sent as g-code lines.
+*/
+
+#ifndef packet_h
+#define packet_h
+
+#define PACKET_END      0xC0
+#define PACKET_ESC      0xDB
+#define PACKET_ESC_XOR  0x20
+
+// Packet opcodes and payloads
+#define PACKET_OP_LINE      0x01 // int32 x,y,z (um). Linear motion to absolute position at feed rate.
+#define PACKET_OP_SEEK      0x02 // int32 x,y,z (um). Linear motion to absolute position at seek rate.
+#define PACKET_OP_LINE_REL  0x03 // int16 x,y,z (um). Linear motion by offset at feed rate.
+#define PACKET_OP_FEED      0x04 // float (mm/min). Sets the feed rate, as F in g-code.
+#define PACKET_OP_DWELL     0x05 // float (sec). Dwell, as G4.
+#define PACKET_OP_EXIT      0x06 // No payload. Leaves packet mode.
+
+// Largest frame, before byte stuffing and excluding PACKET_END: opcode, 12 byte payload, crc.
+#define PACKET_BUFFER_SIZE  14
+
+// Resets the packet decoder and leaves packet mode. Called by protocol_init().
+void packet_init();
+
+// Enters packet mode. Called by the '$B' command.
+void packet_enable();
+
+// Returns true while in packet mode.
+uint8_t packet_enabled();
+
+// Decodes one received byte. Executes the frame and reports its status when the frame is complete.
+void packet_read_byte(uint8_t data);
+
+#endif
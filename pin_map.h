@@ -116,6 +116,13 @@
   #define TX_BUFFER_SIZE 128
   #define BLOCK_BUFFER_SIZE 36
   #define LINE_BUFFER_SIZE 100
+  #define MOTION_QUEUE_SIZE 4
+  #define TX_STATUS_BUFFER_SIZE 96
+  #define EEPROM_QUEUE_SIZE 24
+
+  // More settings profiles in the 4KB EEPROM, above the 1KB used by the Uno layout
+  #define N_SETTINGS_PROFILES 8
+  #define EEPROM_ADDR_PROFILES 1024
 
   // NOTE: All step bit and direction pins must be on the same port.
   #define STEPPING_DDR      DDRA
@@ -127,7 +134,14 @@
   #define X_DIRECTION_BIT   5 // MEGA2560 Digital Pin 27
   #define Y_DIRECTION_BIT   6 // MEGA2560 Digital Pin 28
   #define Z_DIRECTION_BIT   7 // MEGA2560 Digital Pin 29
-  #define STEP_MASK ((1<<X_STEP_BIT)|(1<<Y_STEP_BIT)|(1<<Z_STEP_BIT)) // All step bits
+  #ifdef GANTRY_SLAVE_AXIS
+    // Slaved gantry motor. Shares the direction pin of its axis. Set its bit in the step port
+    // invert mask like the one of its axis.
+    #define SLAVE_STEP_BIT  0 // MEGA2560 Digital Pin 22
+    #define STEP_MASK ((1<<X_STEP_BIT)|(1<<Y_STEP_BIT)|(1<<Z_STEP_BIT)|(1<<SLAVE_STEP_BIT)) // All step bits
+  #else
+    #define STEP_MASK ((1<<X_STEP_BIT)|(1<<Y_STEP_BIT)|(1<<Z_STEP_BIT)) // All step bits
+  #endif
   #define DIRECTION_MASK ((1<<X_DIRECTION_BIT)|(1<<Y_DIRECTION_BIT)|(1<<Z_DIRECTION_BIT)) // All direction bits
   #define STEPPING_MASK (STEP_MASK | DIRECTION_MASK) // All stepping-related bits (step/direction)
 
@@ -146,7 +160,12 @@
   #define LIMIT_INT       PCIE0  // Pin change interrupt enable pin
   #define LIMIT_INT_vect  PCINT0_vect 
   #define LIMIT_PCMSK     PCMSK0 // Pin change interrupt register
-  #define LIMIT_MASK ((1<<X_LIMIT_BIT)|(1<<Y_LIMIT_BIT)|(1<<Z_LIMIT_BIT)) // All limit bits
+  #ifdef GANTRY_SLAVE_AXIS
+    #define SLAVE_LIMIT_BIT 3 // MEGA2560 Digital Pin 50
+    #define LIMIT_MASK ((1<<X_LIMIT_BIT)|(1<<Y_LIMIT_BIT)|(1<<Z_LIMIT_BIT)|(1<<SLAVE_LIMIT_BIT)) // All limit bits
+  #else
+    #define LIMIT_MASK ((1<<X_LIMIT_BIT)|(1<<Y_LIMIT_BIT)|(1<<Z_LIMIT_BIT)) // All limit bits
+  #endif
 
   #define SPINDLE_ENABLE_DDR   DDRC
   #define SPINDLE_ENABLE_PORT  PORTC
@@ -181,6 +200,10 @@
 
 #endif
 
+#if defined(GANTRY_SLAVE_AXIS) && !(defined(SLAVE_STEP_BIT) && defined(SLAVE_LIMIT_BIT))
+  #error "GANTRY_SLAVE_AXIS requires a slave step and limit pin in the pin map"
+#endif
+
 /* 
 #ifdef PIN_MAP_CUSTOM_PROC
   // For a custom pin map or different processor, copy and paste one of the default pin map
@@ -36,6 +36,8 @@
 #include "settings.h"
 #include "config.h"
 #include "protocol.h"
+#include "spindle_control.h"
+#include "coolant_control.h"
 
 static block_t block_buffer[BLOCK_BUFFER_SIZE];  // A ring buffer for motion instructions
 static volatile uint8_t block_buffer_head;       // Index of the next block to be pushed
@@ -52,6 +54,9 @@ typedef struct {
 	                                 // 前一小线段单元向量
 	float previous_nominal_speed;    // Nominal speed of previous path line segment
 	                                 // 前一小线段的速度
+	volatile int8_t spindle_direction; // Spindle state carried by new blocks
+	volatile uint8_t coolant_mode;     // Coolant state carried by new blocks
+	uint16_t line_number;              // Line number carried by new blocks, low 16 bits
 } planner_t;
 static planner_t pl;
 
@@ -280,7 +285,7 @@ static void planner_recalculate_trapezoids()
 	{
 		current = next;
 		next = &block_buffer[block_index];
-		if (current)
+		if (current && !current->dwell_flag) // Dwell trapezoids are fixed when buffered.
 		{
 			// Recalculate if current block entry or exit junction speed has changed.
 			if (current->recalculate_flag || next->recalculate_flag)
@@ -294,8 +299,11 @@ static void planner_recalculate_trapezoids()
 		block_index = next_block_index( block_index );
 	}
 	// Last/newest block in buffer. Exit speed is set with MINIMUM_PLANNER_SPEED. Always recalculated.
-	calculate_trapezoid_for_block(next, next->entry_speed/next->nominal_speed,
-	MINIMUM_PLANNER_SPEED/next->nominal_speed);
+	if (!next->dwell_flag)
+	{
+		calculate_trapezoid_for_block(next, next->entry_speed/next->nominal_speed,
+		MINIMUM_PLANNER_SPEED/next->nominal_speed);
+	}
 	next->recalculate_flag = false;
 }
 
@@ -359,17 +367,52 @@ uint8_t plan_check_full_buffer()
 	return(false);
 }
 
+// Returns the number of free blocks in the ring buffer. One block always stays unused to tell a
+// full buffer from an empty one.
+uint8_t plan_get_block_buffer_available()
+{
+	uint8_t tail = block_buffer_tail; // Copy once. May be updated by the stepper interrupt.
+	if (block_buffer_head >= tail) { return(BLOCK_BUFFER_SIZE-1 - (block_buffer_head-tail)); }
+	return(tail-block_buffer_head-1);
+}
+
 // Block until all buffered steps are executed or in a cycle state. Works with feed hold
 // during a synchronize call, if it should happen. Also, waits for clean cycle end.
 void plan_synchronize()
 {
-	while (plan_get_current_block() || sys.state == STATE_CYCLE)
+	while (plan_get_current_block() || sys.state == STATE_CYCLE || sys.state == STATE_JOG)
 	{ 
 		protocol_execute_runtime();   // Check and execute run-time commands
 		if (sys.abort) { return; }    // Check for system abort
 	}    
 }
 
+// Sets the line number for all blocks buffered from here on. The stepper subsystem reports the
+// number of the block it executes.
+void plan_set_line_number(uint16_t line_number)
+{
+	pl.line_number = line_number;
+}
+
+// Sets the spindle and coolant state for all blocks buffered from here on. The stepper subsystem
+// applies it as each block starts, so a change takes effect at its place in the motion stream
+// without stopping the machine. If nothing is buffered, there is no block to carry the change
+// and it is applied right away. Otherwise, the stepper applies it when the buffer runs empty.
+// NOTE: The state is set before the buffer is checked, so a stepper going idle in between still
+// applies the new state.
+void plan_set_accessory_state(int8_t spindle_direction, uint8_t coolant_mode)
+{
+	pl.spindle_direction = spindle_direction;
+	pl.coolant_mode = coolant_mode;
+	if (plan_get_current_block() == NULL) { plan_apply_accessory_state(); }
+}
+
+void plan_apply_accessory_state()
+{
+	spindle_run(pl.spindle_direction);
+	coolant_run(pl.coolant_mode);
+}
+
 // Add a new linear movement to the buffer. x, y and z is the signed, absolute target position in 
 // millimeters. Feed rate specifies the speed of the motion. If feed rate is inverted, the feed
 // rate is taken to mean "frequency" and would complete the operation in 1/feed_rate minutes.
@@ -503,6 +546,10 @@ void plan_buffer_line(float x, float y, float z, float feed_rate, uint8_t invert
 	if (block->nominal_speed <= v_allowable) { block->nominal_length_flag = true; }
 	else { block->nominal_length_flag = false; }
 	block->recalculate_flag = true; // Always calculate trapezoid for new block
+	block->dwell_flag = false;
+	block->spindle_direction = pl.spindle_direction;
+	block->coolant_mode = pl.coolant_mode;
+	block->line_number = pl.line_number;
 
 	// Update previous path unit_vector and nominal speed
 	memcpy(pl.previous_unit_vec, unit_vec, sizeof(unit_vec)); // pl.previous_unit_vec[] = unit_vec[]
@@ -518,6 +565,54 @@ void plan_buffer_line(float x, float y, float z, float feed_rate, uint8_t invert
 	planner_recalculate(); 
 }
 
+// Add a dwell to the buffer. The dwell is a block with no steps, whose step events are counted by
+// the stepper at a fixed DWELL_TICKS_PER_SECOND rate, so the machine holds position for the given
+// time in order with the buffered motions. The parser and serial intake keep running meanwhile.
+// Junction speeds into and out of the dwell are zero, so the previous block plans a full stop.
+// NOTE: Assumes buffer is available. Buffer checks are handled at a higher level by motion_control.
+void plan_buffer_dwell(float seconds)
+{
+	block_t *block = &block_buffer[block_buffer_head];
+
+	block->step_event_count = lround(seconds*DWELL_TICKS_PER_SECOND);
+	if (block->step_event_count == 0) { return; } // Nothing to wait for.
+
+	block->dwell_flag = true;
+	block->direction_bits = 0;
+	block->steps_x = 0;
+	block->steps_y = 0;
+	block->steps_z = 0;
+	block->spindle_direction = pl.spindle_direction;
+	block->coolant_mode = pl.coolant_mode;
+	block->line_number = pl.line_number;
+
+	// Stationary block. Planned with zero speeds and skipped by the junction speed passes.
+	block->millimeters = 0.0;
+	block->nominal_speed = 0.0;
+	block->entry_speed = 0.0;
+	block->max_entry_speed = 0.0;
+	block->nominal_length_flag = true;
+	block->recalculate_flag = true;
+
+	// Constant tick rate for the whole block. A rate delta of the full rate lets a feed hold stop
+	// the dwell on the next acceleration tick.
+	block->nominal_rate = DWELL_TICKS_PER_SECOND*60;
+	block->initial_rate = block->nominal_rate;
+	block->final_rate = block->nominal_rate;
+	block->rate_delta = block->nominal_rate;
+	block->accelerate_until = 0;
+	block->decelerate_after = block->step_event_count;
+
+	// The next motion starts from rest.
+	pl.previous_nominal_speed = 0.0;
+
+	// Update buffer head and next buffer head indices
+	block_buffer_head = next_buffer_head;  
+	next_buffer_head = next_block_index(block_buffer_head);
+
+	planner_recalculate(); 
+}
+
 // Reset the planner position vector (in steps). Called by the system abort routine.
 void plan_set_current_position(int32_t x, int32_t y, int32_t z)
 {
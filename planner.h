@@ -30,9 +30,10 @@
 #ifndef planner_h
 #define planner_h
                  
-// The number of linear motions that can be in the plan at any give time
+// The number of linear motions that can be in the plan at any give time. Sized for the 2KB SRAM
+// of the Atmega328p. See the RAM budget in config.h.
 #ifndef BLOCK_BUFFER_SIZE
-	#define BLOCK_BUFFER_SIZE 18
+	#define BLOCK_BUFFER_SIZE 14
 #endif
 
 // This struct is used when buffering the setup for each linear movement "nominal" values are as specified in 
@@ -60,6 +61,7 @@ typedef struct {
 	                                    // 拐角重新计算梯形加减速的预处理器标志
 	uint8_t  nominal_length_flag;       // Planner flag for nominal speed always reached
                                         // 达到名义速度的预处理器标志
+	uint8_t  dwell_flag;                // Timed dwell block. No steps, step events count dwell ticks
 
 	// Settings for the trapezoid generator
 	uint32_t initial_rate;              // The step rate at start of block
@@ -74,6 +76,12 @@ typedef struct {
 	                                    //
 	uint32_t nominal_rate;              // The nominal step rate for this block in step_events/minute
 	                                    // 
+
+	// Accessory state applied by the stepper subsystem when this block starts
+	int8_t   spindle_direction;         // Spindle state. 1 = CW, -1 = CCW, 0 = Stop
+	uint8_t  coolant_mode;              // Coolant state. See coolant_control.h
+
+	uint16_t line_number;               // Low 16 bits of the N line number or host sequence id
 } block_t;
       
 // Initialize the motion plan subsystem      
@@ -84,6 +92,10 @@ void plan_init();
 // rate is taken to mean "frequency" and would complete the operation in 1/feed_rate minutes.
 void plan_buffer_line(float x, float y, float z, float feed_rate, uint8_t invert_feed_rate);
 
+// Add a dwell to the buffer. The stepper holds position for the given number of seconds, in order
+// with the buffered motions.
+void plan_buffer_dwell(float seconds);
+
 // Called when the current block is no longer needed. Discards the block and makes the memory
 // availible for new blocks.
 void plan_discard_current_block();
@@ -103,7 +115,22 @@ void plan_reset_buffer();
 // Returns the status of the block ring buffer. True, if buffer is full.
 uint8_t plan_check_full_buffer();
 
+// Returns the number of free blocks in the ring buffer.
+uint8_t plan_get_block_buffer_available();
+
 // Block until all buffered steps are executed
 void plan_synchronize();
 
+// Sets the line number carried by the blocks that follow, for reporting the executing line. Only
+// the low 16 bits are kept. See report_realtime_status().
+void plan_set_line_number(uint16_t line_number);
+
+// Sets the spindle and coolant state carried by the blocks that follow. Applied immediately, if the
+// buffer is empty.
+void plan_set_accessory_state(int8_t spindle_direction, uint8_t coolant_mode);
+
+// Applies the most recently set spindle and coolant state. Called by the stepper subsystem when the
+// buffer runs empty.
+void plan_apply_accessory_state();
+
 #endif
@@ -29,30 +29,38 @@
 
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include <util/crc16.h>
 #include "protocol.h"
 #include "gcode.h"
 #include "serial.h"
 #include "print.h"
 #include "settings.h"
+#include "limits.h"
 #include "config.h"
 #include "nuts_bolts.h"
 #include "stepper.h"
 #include "report.h"
 #include "motion_control.h"
+#include "packet.h"
 
 static char line[LINE_BUFFER_SIZE]; // Line to be executed. Zero-terminated.
-static uint8_t char_counter;        // Last character counter in line variable.
-static uint8_t iscomment;           // Comment/block delete flag for processor to ignore comment characters.
 
-static void protocol_reset_line_buffer()
-{
-	char_counter = 0;               // Reset line input
-	iscomment = false;
-}
+// Line-numbered, checksummed streaming. Enabled with '$L1', after which every line must be framed
+// as 'N<number><line>*<checksum>'. The checksum is the decimal 8-bit Dallas/Maxim CRC of all the
+// characters before the '*', as stored after the receive filter, and line numbers count up by one
+// from N1. A corrupted line, or any line following a lost one, is not executed but answered with
+// 'rs:<number>' to request a resend starting at the line expected next. A line resent after it
+// was already executed is answered with 'ok' again without executing it twice.
+#define FRAME_VALID   0 // Next line in sequence and intact. Execute.
+#define FRAME_REPEAT  1 // Already executed. Acknowledge only.
+#define FRAME_RESEND  2 // Corrupted, or out of sequence after a lost line. Request a resend.
+static uint8_t frame_mode;          // True while framed streaming is enabled
+static int32_t frame_line_number;   // Line number expected next
 
 void protocol_init() 
 {
-	protocol_reset_line_buffer();
+	frame_mode = false;
+	packet_init();
 	report_init_message();         // Welcome message   
 
 	PINOUT_DDR &= ~(PINOUT_MASK);  // Set as input pins
@@ -106,6 +114,35 @@ ISR(PINOUT_INT_vect)
 	}
 }
 
+// Sends the real-time status report through the high-priority status frame, ahead of any other
+// output. While the previous report is still being sent, the request stays pending for the next
+// check point. A report too long for the status frame is printed as regular output instead,
+// unless called while waiting for room in that output. The WCO field is decided once, so a
+// discarded report does not use it up.
+static void protocol_status_report(uint8_t tx_waiting)
+{
+	if (!serial_status_begin()) { return; }
+	uint8_t send_wco = report_wco_due();
+	report_realtime_status(send_wco);
+	if (!serial_status_end())
+	{
+		if (tx_waiting) { return; }
+		report_realtime_status(send_wco);
+	}
+	report_wco_sent(send_wco);
+	bit_false(sys.execute,EXEC_STATUS_REPORT);
+}
+
+// Executes the run-time tasks that never print to the regular serial output. Called by
+// serial_write() while it waits for room in the TX buffer, so a long response, like the settings
+// printout, neither delays status reports nor stops the planner from being fed.
+void protocol_execute_background()
+{
+	if (sys.execute & EXEC_STATUS_REPORT) { protocol_status_report(true); }
+	mc_process_queue();
+	settings_sync_coord_data();
+}
+
 // Executes run-time commands, when required. This is called from various check points in the main
 // program, primarily where there may be a while loop waiting for a buffer to clear space or any
 // point where the execution time from the last check point may be more than a fraction of a second.
@@ -164,8 +201,7 @@ void protocol_execute_runtime()
 		// Execute and serial print status
 		if (rt_exec & EXEC_STATUS_REPORT)
 		{ 
-			report_realtime_status();
-			bit_false(sys.execute,EXEC_STATUS_REPORT);
+			protocol_status_report(false);
 		}
 
 		// Initiate stepper feed hold
@@ -181,6 +217,8 @@ void protocol_execute_runtime()
 		{
 			st_cycle_reinitialize();
 			bit_false(sys.execute,EXEC_CYCLE_STOP);
+			// Steppers kept enabled hold the position, so it stays trusted through a power loss.
+			if (sys.state == STATE_IDLE && settings.stepper_idle_lock_time == 0xff) { limits_park(); }
 		}
 
 		if (rt_exec & EXEC_CYCLE_START)
@@ -196,6 +234,12 @@ void protocol_execute_runtime()
 
 	// Overrides flag byte (sys.override) and execution should be installed here, since they 
 	// are runtime and require a direct and controlled interface to the main stepper program.
+
+	// Feed parsed motions waiting on a full planner into the buffer as soon as blocks retire.
+	mc_process_queue();
+
+	// Trickle changed coordinate data back to EEPROM.
+	settings_sync_coord_data();
 }  
 
 
@@ -269,18 +313,38 @@ uint8_t protocol_execute_line(char *line)
 				}
 				else { return(STATUS_SETTING_DISABLED); }
 				break;
-				//    case 'J' : break;  // Jogging methods
-				// TODO: Here jogging can be placed for execution as a seperate subprogram. It does not need to be 
-				// susceptible to other runtime commands except for e-stop. The jogging function is intended to
-				// be a basic toggle on/off with controlled acceleration and deceleration to prevent skipped 
-				// steps. The user would supply the desired feedrate, axis to move, and direction. Toggle on would
-				// start motion and toggle off would initiate a deceleration to stop. One could 'feather' the
-				// motion by repeatedly toggling to slow the motion to the desired location. Location data would 
-				// need to be updated real-time and supplied to the user through status queries.
-				//   More controlled exact motions can be taken care of by inputting G0 or G1 commands, which are 
-				// handled by the planner. It would be possible for the jog subprogram to insert blocks into the
-				// block buffer without having the planner plan them. It would need to manage de/ac-celerations 
-				// on its own carefully. This approach could be effective and possibly size/memory efficient.
+			case 'S' : // Save the position as cleanly parked, for a quick '$H' after power up
+				if ( line[++char_counter] != 0 ) { return(STATUS_UNSUPPORTED_STATEMENT); }
+				if (bit_isfalse(settings.flags,BITFLAG_HOMING_ENABLE)) { return(STATUS_SETTING_DISABLED); }
+				if ( sys.state != STATE_IDLE ) { return(STATUS_IDLE_ERROR); }
+				if ( !sys.homed ) { return(STATUS_NOT_HOMED); }
+				limits_park();
+				break;
+			case 'P' : // Settings profiles. '$P' prints the active profile, '$Pn' selects profile n.
+				helper_var = line[++char_counter];
+				if ( helper_var == 0 ) { report_settings_profile(); break; }
+				if ( helper_var < '0' || helper_var > '9' || line[++char_counter] != 0 ) { return(STATUS_UNSUPPORTED_STATEMENT); }
+				if ( sys.state != STATE_IDLE && sys.state != STATE_ALARM ) { return(STATUS_IDLE_ERROR); }
+				return(settings_select_profile(helper_var-'0'));
+			case 'B' : // Enter binary packet mode. Following input is decoded as packets until exited.
+				if ( line[++char_counter] != 0 ) { return(STATUS_UNSUPPORTED_STATEMENT); }
+				packet_enable();
+				break;
+			case 'L' : // Framed streaming. '$L1' enables and restarts line numbering at N1, '$L0' disables.
+				helper_var = line[++char_counter];
+				if ( (helper_var != '0' && helper_var != '1') || line[++char_counter] != 0 ) { return(STATUS_UNSUPPORTED_STATEMENT); }
+				frame_mode = (helper_var == '1');
+				frame_line_number = 1;
+				break;
+			case 'U' : // Prints baud rate errors
+				if ( line[++char_counter] != 0 ) { return(STATUS_UNSUPPORTED_STATEMENT); }
+				else { report_baud_rates(); }
+				break;
+			case 'J' : // Jog motion. Runs until complete or cancelled by the jog cancel command or feed hold.
+				if ( line[++char_counter] != '=' ) { return(STATUS_UNSUPPORTED_STATEMENT); }
+				if ( sys.state == STATE_ALARM ) { return(STATUS_ALARM_LOCK); }
+				if ( sys.state != STATE_IDLE && sys.state != STATE_JOG ) { return(STATUS_IDLE_ERROR); }
+				return(gc_execute_jog(&line[char_counter+1]));
 			case 'N' : // Startup lines. 
 				if ( line[++char_counter] == 0 )  // Print startup lines
 				{
@@ -338,24 +402,87 @@ uint8_t protocol_execute_line(char *line)
 }
 
 
-// Process and report status one line of incoming serial data. Performs an initial filtering
-// by removing spaces and comments and capitalizing all letters.
+// Checks the framing of a received line in framed streaming mode. Strips the checksum from a valid
+// line. The line number stays, so the parser picks it up as the block's N word, except in front of
+// a '$' command, where it is stripped too.
+static uint8_t protocol_check_frame()
+{
+	if (line[0] != 'N') { return(FRAME_RESEND); } // Also an overflowed line
+
+	uint8_t crc = 0;
+	uint8_t char_counter = 0;
+	while (line[char_counter] != 0 && line[char_counter] != '*')
+	{
+		crc = _crc_ibutton_update(crc, line[char_counter]);
+		char_counter++;
+	}
+	if (line[char_counter] == 0) { return(FRAME_RESEND); }
+	line[char_counter++] = 0; // Strip checksum
+	float value;
+	if (!read_float(line, &char_counter, &value) || line[char_counter] != 0 || value != crc)
+	{
+		return(FRAME_RESEND);
+	}
+
+	char_counter = 1;
+	if (!read_float(line, &char_counter, &value)) { return(FRAME_RESEND); }
+	int32_t line_number = trunc(value);
+	if (line_number < frame_line_number) { return(FRAME_REPEAT); }
+	if (line_number > frame_line_number) { return(FRAME_RESEND); }
+	frame_line_number++;
+
+	if (line[char_counter] == '$') { memmove(line, &line[char_counter], strlen(&line[char_counter])+1); }
+	return(FRAME_VALID);
+}
+
+// Process and report status of the lines of incoming serial data. The lines arrive already
+// filtered by the serial receive interrupt, with spaces and comments removed and all letters
+// capitalized. In packet mode, the raw bytes are passed to the packet decoder instead.
 void protocol_process()
 {
 	uint8_t c;
-	while((c = serial_read()) != SERIAL_NO_DATA)
+	for (;;)
 	{
-		if ((c == '\n') || (c == '\r'))  // End of line reached
+		if (packet_enabled())
+		{
+			if ((c = serial_read()) == SERIAL_NO_DATA) { return; }
+			packet_read_byte(c);
+			if (sys.abort) { return; }  // Bail to main program upon system abort    
+		}
+		else
 		{
+			if (!serial_read_line(line)) { return; }
+
 			// Runtime command check point before executing line. Prevent any furthur line executions.
 			// NOTE: If there is no line, this function should quickly return to the main program when
 			// the buffer empties of non-executable data.
 			protocol_execute_runtime();
 			if (sys.abort) { return; }  // Bail to main program upon system abort    
 
-			if (char_counter > 0)       // Line is complete. Then execute!
+			if (frame_mode)
+			{
+				// The host never sends empty lines in framed mode. Drop line noise without a response.
+				if (line[0] == 0) { continue; }
+				uint8_t frame = protocol_check_frame();
+				if (frame == FRAME_RESEND)
+				{
+					report_resend_request(frame_line_number);
+					continue;
+				}
+				if (frame == FRAME_REPEAT)
+				{
+					report_status_message(STATUS_OK);
+					continue;
+				}
+			}
+
+			if (line[0] == SERIAL_LINE_OVERFLOW)
+			{
+				// Report line buffer overflow
+				report_status_message(STATUS_OVERFLOW);
+			}
+			else if (line[0] != 0)     // Line is complete. Then execute!
 			{
-				line[char_counter] = 0; // Terminate string
 				report_status_message(protocol_execute_line(line));
 			}
 			else
@@ -363,50 +490,6 @@ void protocol_process()
 				// Empty or comment line. Skip block.
 				report_status_message(STATUS_OK); // Send status message for syncing purposes.
 			}
-			protocol_reset_line_buffer();      
-
-		}
-		else
-		{
-			if (iscomment)
-			{
-				// Throw away all comment characters
-				if (c == ')')
-				{
-					// End of comment. Resume line.
-					iscomment = false;
-				}
-			}
-			else
-			{
-				if (c <= ' ')
-				{ 
-					// Throw away whitepace and control characters
-				}
-				else if (c == '/')
-				{ 
-					// Block delete not supported. Ignore character.
-				}
-				else if (c == '(')
-				{
-					// Enable comments flag and ignore all characters until ')' or EOL.
-					iscomment = true;
-				}
-				else if (char_counter >= LINE_BUFFER_SIZE-1)
-				{
-					// Report line buffer overflow and reset
-					report_status_message(STATUS_OVERFLOW);
-					protocol_reset_line_buffer();
-				}
-				else if (c >= 'a' && c <= 'z')  // Upcase lowercase
-				{
-					line[char_counter++] = c-'a'+'A';
-				}
-				else
-				{
-					line[char_counter++] = c;
-				}
-			}
 		}
 	}
 }
@@ -54,6 +54,9 @@ uint8_t protocol_execute_line(char *line);
 // Checks and executes a runtime command at various stop points in main program
 void protocol_execute_runtime();
 
+// Executes the runtime tasks that do not print to the regular output, while serial_write() waits
+void protocol_execute_background();
+
 // Execute the startup script lines stored in EEPROM upon initialization
 void protocol_execute_startup();
 
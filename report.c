@@ -40,6 +40,21 @@
 #include "nuts_bolts.h"
 #include "gcode.h"
 #include "coolant_control.h"
+#include "planner.h"
+#include "serial.h"
+#include "stepper.h"
+
+
+// Prints the free planner blocks and free serial receive buffer bytes, so a streaming interface
+// can fill Grbl exactly to capacity. The receive buffer stores lines after filtering, which are
+// never longer than the sent lines, so sending up to the reported free bytes is always safe.
+static void report_buffer_state()
+{
+	printPgmString(PSTR("Buf:"));
+	printInteger(plan_get_block_buffer_available());
+	printPgmString(PSTR(",RX:"));
+	printInteger(serial_get_rx_buffer_available());
+}
 
 
 // Handles the primary confirmation protocol response for streaming interfaces and human-feedback.
@@ -54,7 +69,13 @@ void report_status_message(uint8_t status_code)
 {
 	if (status_code == 0) // STATUS_OK
 	{ 
-		printPgmString(PSTR("ok\r\n"));
+		#ifdef REPORT_OK_BUFFER_STATE
+			printPgmString(PSTR("ok "));
+			report_buffer_state();
+			printPgmString(PSTR("\r\n"));
+		#else
+			printPgmString(PSTR("ok\r\n"));
+		#endif
 	} 
 	else 
 	{
@@ -100,6 +121,21 @@ void report_status_message(uint8_t status_code)
 			case STATUS_OVERFLOW:
 				printPgmString(PSTR("Line overflow"));
 				break;
+			case STATUS_PACKET_ERROR:
+				printPgmString(PSTR("Invalid packet"));
+				break;
+			case STATUS_SETTING_BAUD_RATE:
+				printPgmString(PSTR("Baud rate error too high"));
+				break;
+			case STATUS_NOT_HOMED:
+				printPgmString(PSTR("Not homed"));
+				break;
+			case STATUS_SOFT_LIMIT:
+				printPgmString(PSTR("Travel exceeds soft limits"));
+				break;
+			case STATUS_SETTING_PROFILE:
+				printPgmString(PSTR("Invalid settings profile"));
+				break;
 		}
 		printPgmString(PSTR("\r\n"));
 	}
@@ -115,11 +151,25 @@ void report_alarm_message(int8_t alarm_code)
 		printPgmString(PSTR("Hard limit")); break;
 		case ALARM_ABORT_CYCLE: 
 		printPgmString(PSTR("Abort during cycle")); break;
+		case ALARM_HOMING_FAIL: 
+		printPgmString(PSTR("Homing fail")); break;
+		case ALARM_SOFT_LIMIT: 
+		printPgmString(PSTR("Soft limit")); break;
 	}
-	printPgmString(PSTR(". MPos?\r\n"));
+	if (alarm_code == ALARM_SOFT_LIMIT) { printPgmString(PSTR(". MPos kept\r\n")); } // Stopped under control
+	else { printPgmString(PSTR(". MPos?\r\n")); }
 	delay_ms(500); // Force delay to ensure message clears serial write buffer.
 }
 
+// Requests the host to resend all lines from the given line number on. Used only in framed
+// streaming mode, in place of the 'ok' or 'error:' response to a corrupted or out of sequence line.
+void report_resend_request(int32_t line_number)
+{
+	printPgmString(PSTR("rs:"));
+	printInteger(line_number);
+	printPgmString(PSTR("\r\n"));
+}
+
 // Prints feedback messages. This serves as a centralized method to provide additional
 // user feedback for things that are not of the status/alarm message protocol. These are
 // messages such as setup warnings, switch toggling, and how to exit alarms.
@@ -141,6 +191,8 @@ void report_feedback_message(uint8_t message_code)
 		printPgmString(PSTR("Enabled")); break;
 		case MESSAGE_DISABLED:
 		printPgmString(PSTR("Disabled")); break;    
+		case MESSAGE_PARKED:
+		printPgmString(PSTR("Parked. '$H' re-homes quickly")); break;
 	}
 	printPgmString(PSTR("]\r\n"));
 }
@@ -164,16 +216,32 @@ void report_grbl_help()
 	                  "$C (check gcode mode)\r\n"
 	                  "$X (kill alarm lock)\r\n"
 	                  "$H (run homing cycle)\r\n"
+	                  "$S (save parked position)\r\n"
+	                  "$P (view settings profile), $Pn (select)\r\n"
+	                  "$B (enter binary packet mode)\r\n"
+	                  "$J=line (jog)\r\n"
+	                  "$L1 (numbered checksummed lines, $L0 to end)\r\n"
+	                  "$U (view baud rate errors)\r\n"
 	                  "~ (cycle start)\r\n"
 	                  "! (feed hold)\r\n"
 	                  "? (current status)\r\n"
-	                  "ctrl-x (reset Grbl)\r\n"));
+	                  "ctrl-x (reset Grbl)\r\n"
+	                  "0x85 (jog cancel)\r\n"));
+}
+
+// Prints the active settings profile.
+void report_settings_profile()
+{
+	printPgmString(PSTR("[Profile "));
+	printInteger(settings_get_profile());
+	printPgmString(PSTR("]\r\n"));
 }
 
-// Grbl global settings print out.
+// Grbl global settings print out. Shows the active settings profile.
 // NOTE: The numbering scheme here must correlate to storing in settings.c
 void report_grbl_settings() 
 {
+	report_settings_profile();
 	printPgmString(PSTR("$0=")); printFloat(settings.steps_per_mm[X_AXIS]);
 	printPgmString(PSTR(" (x, step/mm)\r\n$1=")); printFloat(settings.steps_per_mm[Y_AXIS]);
 	printPgmString(PSTR(" (y, step/mm)\r\n$2=")); printFloat(settings.steps_per_mm[Z_AXIS]);
@@ -185,8 +253,8 @@ void report_grbl_settings()
 	printPgmString(PSTR(")\r\n$7=")); printInteger(settings.stepper_idle_lock_time);
 	printPgmString(PSTR(" (step idle delay, msec)\r\n$8=")); printFloat(settings.acceleration/(60*60)); // Convert from mm/min^2 for human readability
 	printPgmString(PSTR(" (acceleration, mm/sec^2)\r\n$9=")); printFloat(settings.junction_deviation);
-	printPgmString(PSTR(" (junction deviation, mm)\r\n$10=")); printFloat(settings.mm_per_arc_segment);
-	printPgmString(PSTR(" (arc, mm/segment)\r\n$11=")); printInteger(settings.n_arc_correction);
+	printPgmString(PSTR(" (junction deviation, mm)\r\n$10=")); printFloat(settings.arc_tolerance);
+	printPgmString(PSTR(" (arc tolerance, mm)\r\n$11=")); printInteger(settings.n_arc_correction);
 	printPgmString(PSTR(" (n-arc correction, int)\r\n$12=")); printInteger(settings.decimal_places);
 	printPgmString(PSTR(" (n-decimals, int)\r\n$13=")); printInteger(bit_istrue(settings.flags,BITFLAG_REPORT_INCHES));
 	printPgmString(PSTR(" (report inches, bool)\r\n$14=")); printInteger(bit_istrue(settings.flags,BITFLAG_AUTO_START));
@@ -196,10 +264,63 @@ void report_grbl_settings()
 	printPgmString(PSTR(" (homing cycle, bool)\r\n$18=")); printInteger(settings.homing_dir_mask);
 	printPgmString(PSTR(" (homing dir invert mask, int:")); print_uint8_base2(settings.homing_dir_mask);  
 	printPgmString(PSTR(")\r\n$19=")); printFloat(settings.homing_feed_rate);
-	printPgmString(PSTR(" (homing feed, mm/min)\r\n$20=")); printFloat(settings.homing_seek_rate);
-	printPgmString(PSTR(" (homing seek, mm/min)\r\n$21=")); printInteger(settings.homing_debounce_delay);
-	printPgmString(PSTR(" (homing debounce, msec)\r\n$22=")); printFloat(settings.homing_pulloff);
-	printPgmString(PSTR(" (homing pull-off, mm)\r\n")); 
+	printPgmString(PSTR(" (homing feed, all axes, mm/min)\r\n$20=")); printFloat(settings.homing_seek_rate);
+	printPgmString(PSTR(" (homing seek, all axes, mm/min)\r\n$21=")); printInteger(settings.limit_debounce_time);
+	printPgmString(PSTR(" (limit debounce, usec)\r\n$22=")); printFloat(settings.homing_pulloff);
+	printPgmString(PSTR(" (homing pull-off, all axes, mm)\r\n$23=")); printInteger(settings.status_report_mask);
+	printPgmString(PSTR(" (status report mask, int:")); print_uint8_base2(settings.status_report_mask);
+	printPgmString(PSTR(")\r\n$24=")); printInteger(settings.baud_rate);
+	printPgmString(PSTR(" (baud rate, applied on reset)\r\n$25=")); printFloat(settings.homing_axis_feed_rate[X_AXIS]);
+	printPgmString(PSTR(" (x, homing feed, mm/min)\r\n$26=")); printFloat(settings.homing_axis_feed_rate[Y_AXIS]);
+	printPgmString(PSTR(" (y, homing feed, mm/min)\r\n$27=")); printFloat(settings.homing_axis_feed_rate[Z_AXIS]);
+	printPgmString(PSTR(" (z, homing feed, mm/min)\r\n$28=")); printFloat(settings.homing_axis_seek_rate[X_AXIS]);
+	printPgmString(PSTR(" (x, homing seek, mm/min)\r\n$29=")); printFloat(settings.homing_axis_seek_rate[Y_AXIS]);
+	printPgmString(PSTR(" (y, homing seek, mm/min)\r\n$30=")); printFloat(settings.homing_axis_seek_rate[Z_AXIS]);
+	printPgmString(PSTR(" (z, homing seek, mm/min)\r\n$31=")); printFloat(settings.homing_axis_pulloff[X_AXIS]);
+	printPgmString(PSTR(" (x, homing pull-off, mm)\r\n$32=")); printFloat(settings.homing_axis_pulloff[Y_AXIS]);
+	printPgmString(PSTR(" (y, homing pull-off, mm)\r\n$33=")); printFloat(settings.homing_axis_pulloff[Z_AXIS]);
+	printPgmString(PSTR(" (z, homing pull-off, mm)\r\n$34=")); printInteger(bit_istrue(settings.flags,BITFLAG_SOFT_LIMIT_ENABLE));
+	printPgmString(PSTR(" (soft limits, bool)\r\n$35=")); printFloat(settings.max_travel[X_AXIS]);
+	printPgmString(PSTR(" (x, max travel, mm)\r\n$36=")); printFloat(settings.max_travel[Y_AXIS]);
+	printPgmString(PSTR(" (y, max travel, mm)\r\n$37=")); printFloat(settings.max_travel[Z_AXIS]);
+	printPgmString(PSTR(" (z, max travel, mm)\r\n"));
+}
+
+
+// Prints the baud rate error at the CPU clock for the common baud rates and the baud rate setting,
+// with the UBRR0 value and U2X mode Grbl selects. Rates beyond the error limit are marked.
+void report_baud_rates()
+{
+	static const uint32_t baud_rates[] PROGMEM = { 9600, 19200, 38400, 57600, 115200, 230400, 250000, 500000, 1000000 };
+	uint8_t n_baud_rates = sizeof(baud_rates)/sizeof(uint32_t);
+	uint8_t setting_listed = false;
+	uint8_t i;
+	for (i=0; i<=n_baud_rates; i++)
+	{
+		uint32_t baud_rate;
+		if (i < n_baud_rates) { baud_rate = pgm_read_dword(&baud_rates[i]); }
+		else if (!setting_listed) { baud_rate = settings.baud_rate; } // Uncommon rate setting last
+		else { break; }
+		
+		uint16_t ubrr, ubrr_u2x;
+		float error = serial_baud_error(baud_rate, false, &ubrr);
+		float error_u2x = serial_baud_error(baud_rate, true, &ubrr_u2x);
+		uint8_t u2x = (fabs(error_u2x) < fabs(error));
+		if (u2x) { error = error_u2x; ubrr = ubrr_u2x; }
+		printPgmString(PSTR("["));
+		printInteger(baud_rate);
+		printPgmString(PSTR(":UBRR ")); printInteger(ubrr);
+		printPgmString(PSTR(",U2X ")); printInteger(u2x);
+		printPgmString(PSTR(",Err ")); printFloat(error);
+		printPgmString(PSTR("%"));
+		if (fabs(error) > SERIAL_BAUD_MAX_ERROR) { printPgmString(PSTR(",Rejected")); }
+		if (baud_rate == settings.baud_rate) 
+		{ 
+			printPgmString(PSTR(",Setting")); 
+			setting_listed = true;
+		}
+		printPgmString(PSTR("]\r\n"));
+	}
 }
 
 
@@ -318,21 +439,93 @@ void report_startup_line(uint8_t n, char *line)
 	printPgmString(PSTR("\r\n"));
 }
 
+// Work coordinate offset (G54+ plus G92) as of the last status report, in mm and in steps. Kept
+// so integer steps reports need no float conversions and the WCO field is sent only on change.
+static float report_wco[N_AXIS];
+static int32_t report_wco_steps[N_AXIS];
+static uint8_t report_wco_counter; // Status reports left until an unchanged WCO is sent again
+static uint8_t report_wco_changed; // WCO changed since it was last delivered
+
+// Updates the work coordinate offset copy from the parser state. Returns true if it changed.
+static uint8_t report_update_wco()
+{
+	uint8_t i;
+	uint8_t changed = false;
+	for (i=0; i<N_AXIS; i++)
+	{
+		float offset = gc.coord_system[i]+gc.coord_offset[i];
+		if (offset != report_wco[i])
+		{
+			report_wco[i] = offset;
+			report_wco_steps[i] = lround(offset*settings.steps_per_mm[i]);
+			changed = true;
+		}
+	}
+	return(changed);
+}
+
+// Returns true, if the next status report should include the WCO field: upon change, and every so
+// often in case a report was missed. A report may be printed more than once, when it does not fit
+// the status frame, so the decision is taken once per request and only committed by
+// report_wco_sent() after the report went out.
+uint8_t report_wco_due()
+{
+	if (report_update_wco()) { report_wco_changed = true; }
+	if (bit_isfalse(settings.status_report_mask,BITFLAG_RT_STATUS_WORK_OFFSET)) { return(false); }
+	return(report_wco_changed || report_wco_counter == 0);
+}
+
+void report_wco_sent(uint8_t wco_sent)
+{
+	if (bit_isfalse(settings.status_report_mask,BITFLAG_RT_STATUS_WORK_OFFSET)) { return; }
+	if (wco_sent)
+	{
+		report_wco_changed = false;
+		report_wco_counter = REPORT_WCO_REFRESH_COUNT-1;
+	}
+	else
+	{
+		report_wco_counter--;
+	}
+}
+
+// Prints a comma separated vector of integer step counts.
+static void print_steps_vector(int32_t *vector)
+{
+	uint8_t i;
+	for (i=0; i<N_AXIS; i++)
+	{
+		printInteger(vector[i]);
+		if (i < N_AXIS-1) { printPgmString(PSTR(",")); }
+	}
+}
+
+// Prints a comma separated vector in mm, converted to inches if selected in the settings.
+static void print_mm_vector(float *vector)
+{
+	uint8_t i;
+	for (i=0; i<N_AXIS; i++)
+	{
+		if (bit_istrue(settings.flags,BITFLAG_REPORT_INCHES)) { printFloat(vector[i]*INCH_PER_MM); }
+		else { printFloat(vector[i]); }
+		if (i < N_AXIS-1) { printPgmString(PSTR(",")); }
+	}
+}
+
  // Prints real-time data. This function grabs a real-time snapshot of the stepper subprogram 
  // and the actual location of the CNC machine. Users may change the following function to their
  // specific needs, but the desired real-time data report must be as short as possible. This is
  // requires as it minimizes the computational overhead and allows grbl to keep running smoothly, 
  // especially during g-code programs with fast, short line segments and high frequency reports (5-20Hz).
-void report_realtime_status()
+ // The fields are selected by the status report mask setting. For high rate polling, a host may
+ // select MPos with WCO instead of WPos, which is then only sent when the work offset changes, and
+ // integer steps, which skips the float conversion and printing of the positions entirely.
+void report_realtime_status(uint8_t send_wco)
 {
-	// **Under construction** Bare-bones status report. Provides real-time machine position relative to 
-	// the system power on location (0,0,0) and work coordinate position (G54 and G92 applied). Eventually
-	// to be added are distance to go on block, processed block id, and feed rate. Also a settings bitmask
-	// for a user to select the desired real-time data.
 	uint8_t i;
 	int32_t current_position[3]; // Copy current state of the system position variable
 	memcpy(current_position,sys.position,sizeof(sys.position));
-	float print_position[3];
+	uint8_t mask = settings.status_report_mask;
 
 	// Report current machine state
 	switch (sys.state)
@@ -345,32 +538,87 @@ void report_realtime_status()
 		case STATE_HOMING: printPgmString(PSTR("<Home")); break;
 		case STATE_ALARM: printPgmString(PSTR("<Alarm")); break;
 		case STATE_CHECK_MODE: printPgmString(PSTR("<Check")); break;
+		case STATE_JOG: printPgmString(PSTR("<Jog")); break;
 	}
 
-	// Report machine position
-	printPgmString(PSTR(",MPos:")); 
-	for (i=0; i<= 2; i++)
+	// Report machine and work position
+	if (bit_istrue(mask,BITFLAG_RT_STATUS_INTEGER_STEPS))
 	{
-		print_position[i] = current_position[i]/settings.steps_per_mm[i];
-		if (bit_istrue(settings.flags,BITFLAG_REPORT_INCHES)) { print_position[i] *= INCH_PER_MM; }
-		printFloat(print_position[i]);
-		printPgmString(PSTR(","));
+		if (bit_istrue(mask,BITFLAG_RT_STATUS_MACHINE_POSITION))
+		{
+			printPgmString(PSTR(",MPos:"));
+			print_steps_vector(current_position);
+		}
+		if (bit_istrue(mask,BITFLAG_RT_STATUS_WORK_POSITION))
+		{
+			for (i=0; i<N_AXIS; i++) { current_position[i] -= report_wco_steps[i]; }
+			printPgmString(PSTR(",WPos:"));
+			print_steps_vector(current_position);
+		}
 	}
-
-	// Report work position
-	printPgmString(PSTR("WPos:")); 
-	for (i=0; i<= 2; i++)
+	else if (mask & (BITFLAG_RT_STATUS_MACHINE_POSITION|BITFLAG_RT_STATUS_WORK_POSITION))
 	{
-		if (bit_istrue(settings.flags,BITFLAG_REPORT_INCHES))
+		float print_position[N_AXIS];
+		for (i=0; i<N_AXIS; i++) { print_position[i] = current_position[i]/settings.steps_per_mm[i]; }
+		if (bit_istrue(mask,BITFLAG_RT_STATUS_MACHINE_POSITION))
 		{
-			print_position[i] -= (gc.coord_system[i]+gc.coord_offset[i])*INCH_PER_MM;
+			printPgmString(PSTR(",MPos:"));
+			print_mm_vector(print_position);
 		}
-		else
+		if (bit_istrue(mask,BITFLAG_RT_STATUS_WORK_POSITION))
 		{
-			print_position[i] -= gc.coord_system[i]+gc.coord_offset[i];
+			for (i=0; i<N_AXIS; i++) { print_position[i] -= report_wco[i]; }
+			printPgmString(PSTR(",WPos:"));
+			print_mm_vector(print_position);
 		}
-		printFloat(print_position[i]);
-		if (i < 2) { printPgmString(PSTR(",")); }
+	}
+
+	// Report work coordinate offset, when due. See report_wco_due().
+	if (send_wco)
+	{
+		printPgmString(PSTR(",WCO:"));
+		if (bit_istrue(mask,BITFLAG_RT_STATUS_INTEGER_STEPS)) { print_steps_vector(report_wco_steps); }
+		else { print_mm_vector(report_wco); }
+	}
+
+	// Report current feed rate
+	if (bit_istrue(mask,BITFLAG_RT_STATUS_FEED_RATE))
+	{
+		printPgmString(PSTR(",F:"));
+		if (bit_istrue(settings.flags,BITFLAG_REPORT_INCHES)) { printFloat(st_get_realtime_rate()*INCH_PER_MM); }
+		else { printFloat(st_get_realtime_rate()); }
+	}
+
+	// Report free planner blocks and serial receive buffer bytes
+	if (bit_istrue(mask,BITFLAG_RT_STATUS_BUFFER_STATE))
+	{
+		printPgmString(PSTR(","));
+		report_buffer_state();
+	}
+
+	// Report the line number of the executing block and of the last parsed line. The difference
+	// is the program still queued between the parser and the steppers. Blocks only carry the low
+	// 16 bits, which are completed from the parsed line, as the executing line lags behind it by
+	// far less than 65536.
+	if (bit_istrue(mask,BITFLAG_RT_STATUS_LINE_NUMBER))
+	{
+		printPgmString(PSTR(",Ln:"));
+		printInteger(gc.line_number - (uint16_t)((uint16_t)gc.line_number - st_get_line_number()));
+		printPgmString(PSTR(","));
+		printInteger(gc.line_number);
+	}
+
+	// Report triggered limit switches as one digit per axis, X first
+	if (bit_istrue(mask,BITFLAG_RT_STATUS_LIMIT_PINS))
+	{
+		uint8_t limit_state = LIMIT_PIN;
+		#ifndef LIMIT_SWITCHES_ACTIVE_HIGH
+			limit_state ^= LIMIT_MASK; // Pulled up. A low pin is a triggered switch.
+		#endif
+		printPgmString(PSTR(",Lim:"));
+		printInteger(bit_istrue(limit_state,bit(X_LIMIT_BIT)));
+		printInteger(bit_istrue(limit_state,bit(Y_LIMIT_BIT)));
+		printInteger(bit_istrue(limit_state,bit(Z_LIMIT_BIT)));
 	}
 
 	printPgmString(PSTR(">\r\n"));
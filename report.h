@@ -45,10 +45,17 @@
 #define STATUS_IDLE_ERROR				11
 #define STATUS_ALARM_LOCK				12
 #define STATUS_OVERFLOW					13
+#define STATUS_PACKET_ERROR				14
+#define STATUS_SETTING_BAUD_RATE		15
+#define STATUS_NOT_HOMED				16
+#define STATUS_SOFT_LIMIT				17
+#define STATUS_SETTING_PROFILE			18
 
 // Define Grbl alarm codes. Less than zero to distinguish alarm error from status error.
 #define ALARM_HARD_LIMIT				-1
 #define ALARM_ABORT_CYCLE				-2
+#define ALARM_HOMING_FAIL				-3
+#define ALARM_SOFT_LIMIT				-4
 
 // Define Grbl feedback message codes.
 #define MESSAGE_CRITICAL_EVENT			1
@@ -56,6 +63,7 @@
 #define MESSAGE_ALARM_UNLOCK			3
 #define MESSAGE_ENABLED					4
 #define MESSAGE_DISABLED				5
+#define MESSAGE_PARKED					6
 
 // Prints system status messages.
 void report_status_message(uint8_t status_code);
@@ -63,6 +71,9 @@ void report_status_message(uint8_t status_code);
 // Prints system alarm messages.
 void report_alarm_message(int8_t alarm_code);
 
+// Prints a resend request for framed streaming.
+void report_resend_request(int32_t line_number);
+
 // Prints miscellaneous feedback messages.
 void report_feedback_message(uint8_t message_code);
 
@@ -75,8 +86,20 @@ void report_grbl_help();
 // Prints Grbl global settings
 void report_grbl_settings();
 
-// Prints realtime status report
-void report_realtime_status();
+// Prints the active settings profile
+void report_settings_profile();
+
+// Prints the baud rate errors and register values for the common baud rates
+void report_baud_rates();
+
+// Returns true, if the next realtime status report is due to include the work coordinate offset
+uint8_t report_wco_due();
+
+// Prints realtime status report, with the work coordinate offset if send_wco is set
+void report_realtime_status(uint8_t send_wco);
+
+// Records that a realtime status report has been delivered, with or without the work coordinate offset
+void report_wco_sent(uint8_t wco_sent);
 
 // Prints Grbl persistent coordinate parameters
 void report_gcode_parameters();
@@ -0,0 +1,189 @@
+#!/usr/bin/env python
+"""\
+Stream g-code to grbl with line numbers, checksums and resends
+
+Enables grbl's framed streaming mode with '$L1' and sends every
+line as 'N<number><line>*<checksum>'. Grbl answers each line with
+'ok' or 'error:', or with 'rs:<n>' when the line arrived corrupted
+or a line before it was lost. The streamer then waits for the lines
+still in flight to be answered, which grbl rejects the same way,
+and resends from line n. Lines grbl already executed are only
+acknowledged again, so resending too much is always safe.
+
+Flow control is character counting, as stream.py. Lines are
+normalized before framing (comments and spaces removed, upper case),
+since grbl checks the checksum against the line as it stores it.
+
+  The MIT License (MIT)
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+
+"""
+
+import re
+import time
+import argparse
+import collections
+
+RX_BUFFER_SIZE = 128
+
+def crc8(data):
+    """8-bit Dallas/Maxim CRC, as avr-libc _crc_ibutton_update()"""
+    crc = 0
+    for b in bytearray(data):
+        crc ^= b
+        for i in range(8):
+            if crc & 1: crc = (crc >> 1) ^ 0x8C
+            else: crc >>= 1
+    return crc
+
+def normalize(line):
+    """Returns the line as grbl's receive filter stores it"""
+    return re.sub(r'\s|\(.*?\)|/', '', line).upper()
+
+def frame(number, line):
+    """Builds a framed line: N<number><line>*<checksum>"""
+    body = ('N%d%s' % (number, line)).encode('ascii')
+    return body + ('*%d\n' % crc8(body)).encode('ascii')
+
+class ResendWindow:
+    """Keeps grbl's receive buffer full of framed lines and rewinds on resend requests.
+    Line number n is lines[n-1]. Each sent line is answered exactly once, in order, unless it was
+    lost or damaged on the way, so after a rewind the lines still in flight are drained before
+    resending, which also resynchronizes the character count."""
+    def __init__(self, lines, rx_buffer_size=RX_BUFFER_SIZE, quiet_time=1.0, timeout=30.0):
+        self.lines = lines
+        self.rx_buffer_size = rx_buffer_size
+        self.quiet_time = quiet_time  # Silence after which a drain gives up on lost responses
+        self.timeout = timeout        # Silence after which the oldest line in flight is resent
+        self.next = 1                 # Next line number to send
+        self.in_flight = collections.deque()  # (number, length) sent and not yet answered
+        self.draining = False         # Waiting for rejected lines before resending
+        self.last_response = time.time()
+        self.resends = 0
+        self.errors = []
+
+    def done(self):
+        return self.next > len(self.lines) and not self.in_flight
+
+    def pending_bytes(self):
+        return sum(length for number, length in self.in_flight)
+
+    def next_frame(self):
+        """Returns the next framed line, if grbl has room for it, and counts it in flight"""
+        if self.draining or self.next > len(self.lines): return None
+        data = frame(self.next, self.lines[self.next-1])
+        if self.in_flight and self.pending_bytes() + len(data) > self.rx_buffer_size-1: return None
+        self.in_flight.append((self.next, len(data)))
+        self.next += 1
+        return data
+
+    def response(self, text):
+        """Handles a response line. Returns the line number it answered, if known."""
+        self.last_response = time.time()
+        if not self.in_flight: return None # Spurious, e.g. a line split by noise
+        number, length = self.in_flight.popleft()
+        if self.draining:
+            if not self.in_flight: self.draining = False
+            return None
+        if text.startswith('rs:'):
+            self.rewind(int(text[3:]))
+        elif text.startswith('error'):
+            self.errors.append((number, text))
+        return number
+
+    def rewind(self, number):
+        self.next = number
+        self.resends += 1
+        self.draining = bool(self.in_flight)
+
+    def poll(self):
+        """Handles response timeouts. Call regularly while waiting for responses."""
+        silence = time.time() - self.last_response
+        if self.draining and silence > self.quiet_time:
+            # Responses of lost lines never come. Whatever grbl still holds is rejected anyway.
+            self.in_flight.clear()
+            self.draining = False
+        elif self.in_flight and not self.draining and silence > self.timeout:
+            # The last lines or their responses were lost. Resending is safe, since grbl only
+            # acknowledges lines it already executed.
+            oldest = self.in_flight[0][0]
+            self.in_flight.clear()
+            self.rewind(oldest)
+            self.last_response = time.time()
+
+def main():
+    parser = argparse.ArgumentParser(description='Stream g-code file to grbl with line numbers and checksums. (pySerial and argparse libraries required)')
+    parser.add_argument('gcode_file', type=argparse.FileType('r'),
+            help='g-code filename to be streamed')
+    parser.add_argument('device_file',
+            help='serial device path')
+    parser.add_argument('-b','--baud', type=int, default=9600,
+            help='serial baud rate')
+    parser.add_argument('-t','--timeout', type=float, default=30.0,
+            help='seconds without a response before resending the oldest line in flight')
+    parser.add_argument('-q','--quiet',action='store_true', default=False,
+            help='suppress output text')
+    args = parser.parse_args()
+    verbose = not args.quiet
+
+    lines = [l for l in (normalize(raw) for raw in args.gcode_file) if l]
+    lines.append('$L0') # Leave framed mode as the last line of the sequence
+
+    import serial
+    s = serial.Serial(args.device_file, args.baud, timeout=0.05)
+
+    # Wake up grbl
+    print("Initializing grbl...")
+    s.write(b"\r\n\r\n")
+
+    # Wait for grbl to initialize and flush startup text in serial input
+    time.sleep(2)
+    s.flushInput()
+
+    # Enable framed mode. Grbl expects framed lines only after this 'ok'.
+    s.write(b"$L1\n")
+    while s.readline().strip().decode('ascii', 'replace') != 'ok': pass
+
+    print("Streaming %s to %s" % (args.gcode_file.name, args.device_file))
+    window = ResendWindow(lines, timeout=args.timeout)
+    received = b''
+    while not window.done():
+        data = window.next_frame()
+        while data is not None:
+            s.write(data)
+            data = window.next_frame()
+        received += s.read(max(1, s.inWaiting()))
+        while b'\n' in received:
+            out, received = received.split(b'\n', 1)
+            out = out.strip().decode('ascii', 'replace')
+            if not out: continue
+            if out.startswith('ok') or out.startswith('error') or out.startswith('rs:'):
+                number = window.response(out)
+                if verbose or not out.startswith('ok'): print("REC %s: %s" % (number, out))
+            elif verbose:
+                print("  Debug: " + out)
+        window.poll()
+
+    print("G-code streaming finished! %d lines, %d resends, %d errors" % (len(lines)-1, window.resends, len(window.errors)))
+    for number, text in window.errors: print("  Line %d: %s" % (number, text))
+    s.close()
+
+if __name__ == '__main__':
+    main()
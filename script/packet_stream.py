@@ -0,0 +1,261 @@
+#!/usr/bin/env python
+"""\
+Stream g-code to grbl controller as binary motion packets
+
+Encodes G0/G1 moves, feed rates and G4 dwells into grbl's compact
+binary packet format (see packet.h) and streams them after entering
+packet mode with '$B'. Lines that cannot be encoded are sent as
+plain g-code by briefly leaving packet mode. Flow control is the
+same character counting as stream.py, since grbl answers every
+packet with 'ok' or 'error:' just like a line. The stream waits
+for all responses at each switch into and out of packet mode.
+
+With --dump, the encoded stream is written to a file instead of a
+serial port and the byte counts are reported, which needs no grbl.
+
+  The MIT License (MIT)
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+
+"""
+
+import re
+import struct
+import time
+import argparse
+
+RX_BUFFER_SIZE = 128
+
+# Must match packet.h and the runtime command characters in config.h
+PACKET_END = 0xC0
+PACKET_ESC = 0xDB
+PACKET_ESC_XOR = 0x20
+PACKET_STUFFED = (PACKET_END, PACKET_ESC, 0xFF, ord('?'), ord('!'), ord('~'), 0x18, 0x85)
+
+PACKET_OP_LINE = 0x01
+PACKET_OP_SEEK = 0x02
+PACKET_OP_LINE_REL = 0x03
+PACKET_OP_FEED = 0x04
+PACKET_OP_DWELL = 0x05
+PACKET_OP_EXIT = 0x06
+
+MM_PER_INCH = 25.4
+
+def crc8(data):
+    """8-bit Dallas/Maxim CRC, as avr-libc _crc_ibutton_update()"""
+    crc = 0
+    for b in data:
+        crc ^= b
+        for i in range(8):
+            if crc & 1: crc = (crc >> 1) ^ 0x8C
+            else: crc >>= 1
+    return crc
+
+def frame(opcode, payload=b''):
+    """Builds a byte stuffed packet frame"""
+    data = bytearray([opcode]) + bytearray(payload)
+    data.append(crc8(data))
+    out = bytearray()
+    for b in data:
+        if b in PACKET_STUFFED:
+            out.append(PACKET_ESC)
+            out.append(b ^ PACKET_ESC_XOR)
+        else:
+            out.append(b)
+    out.append(PACKET_END)
+    return out
+
+class Encoder:
+    """Converts g-code lines into packet frames, tracking the modal state needed to do so.
+    encode() returns a list of (bytes, is_packet) items to send in order."""
+    def __init__(self):
+        self.motion = None     # 0 = G0, 1 = G1
+        self.absolute = True   # G90/G91
+        self.scale = 1.0       # mm per program unit
+        self.inverse = False   # G93/G94. Packets carry mm/min feed rates only.
+        self.pos = None        # Work position in um, unknown until the first absolute move
+        self.packet_mode = False
+
+    def enter(self, out):
+        if not self.packet_mode:
+            out.append((b'$B\n', False))
+            self.packet_mode = True
+
+    def leave(self, out):
+        if self.packet_mode:
+            out.append((frame(PACKET_OP_EXIT), True))
+            self.packet_mode = False
+
+    def ascii(self, line, out):
+        self.leave(out)
+        out.append((line.encode('ascii') + b'\n', False))
+
+    def encode(self, raw):
+        out = []
+        line = re.sub(r'\s|\(.*?\)', '', raw).upper()
+        if not line:
+            return out
+        words = re.findall(r'([A-Z])([-+]?[0-9]*\.?[0-9]+)', line)
+        if ''.join(l+v for l, v in words) != line:
+            self.ascii(line, out) # Let grbl report anything not understood here
+            self.pos = None
+            return out
+
+        motion, absolute, scale, inverse = self.motion, self.absolute, self.scale, self.inverse
+        axes = {}
+        feed = dwell = None
+        for letter, value in words:
+            v = float(value)
+            if letter == 'G' and v in (0, 1): motion = int(v)
+            elif letter == 'G' and v == 4: dwell = 0.0
+            elif letter == 'G' and v == 90: absolute = True
+            elif letter == 'G' and v == 91: absolute = False
+            elif letter == 'G' and v == 20: scale = MM_PER_INCH
+            elif letter == 'G' and v == 21: scale = 1.0
+            elif letter == 'G' and v == 93: inverse = True
+            elif letter == 'G' and v == 94: inverse = False
+            elif letter in 'XYZ': axes['XYZ'.index(letter)] = v
+            elif letter == 'F': feed = v
+            elif letter == 'P' and dwell is not None: dwell = v
+            elif letter == 'N': pass
+            else:
+                # Not encodable. Pass through and, unless it is a plain M, S or T command, forget
+                # the position, which the line may change.
+                self.motion, self.absolute, self.scale, self.inverse = motion, absolute, scale, inverse
+                self.ascii(line, out)
+                if any(l not in 'MST' for l, v in words): self.pos = None
+                return out
+        if (dwell is not None and axes) or (axes and motion is None):
+            self.ascii(line, out)
+            return out
+        if inverse != self.inverse or (inverse and (feed is not None or (axes and motion == 1))):
+            # Packets carry mm/min feed rates only. The G93/G94 switch and inverse time feeds and
+            # moves are sent as g-code, and grbl resolves the position this once.
+            self.motion, self.absolute, self.scale, self.inverse = motion, absolute, scale, inverse
+            self.ascii(line, out)
+            if axes: self.pos = None
+            return out
+        self.motion, self.absolute, self.scale = motion, absolute, scale
+
+        if feed is not None:
+            self.enter(out)
+            out.append((frame(PACKET_OP_FEED, struct.pack('<f', feed*scale)), True))
+        if dwell is not None:
+            self.enter(out)
+            out.append((frame(PACKET_OP_DWELL, struct.pack('<f', dwell)), True))
+        if axes:
+            if self.pos is None and not (absolute and len(axes) == 3):
+                # Start position unknown. Let grbl resolve missing axes this once.
+                self.ascii(line, out)
+                return out
+            target = list(self.pos) if self.pos is not None else [0, 0, 0]
+            for i, v in axes.items():
+                um = int(round(v*scale*1000))
+                target[i] = um if absolute else target[i] + um
+            delta = [t - p for t, p in zip(target, self.pos)] if self.pos is not None else None
+            self.enter(out)
+            if motion == 1 and delta is not None and all(-32768 <= d <= 32767 for d in delta):
+                out.append((frame(PACKET_OP_LINE_REL, struct.pack('<hhh', *delta)), True))
+            else:
+                opcode = PACKET_OP_LINE if motion == 1 else PACKET_OP_SEEK
+                out.append((frame(opcode, struct.pack('<iii', *target)), True))
+            self.pos = target
+        return out
+
+    def finish(self):
+        out = []
+        self.leave(out)
+        return out
+
+def main():
+    parser = argparse.ArgumentParser(description='Stream g-code file to grbl as binary packets. (pySerial and argparse libraries required)')
+    parser.add_argument('gcode_file', type=argparse.FileType('r'),
+            help='g-code filename to be streamed')
+    parser.add_argument('device_file', nargs='?',
+            help='serial device path')
+    parser.add_argument('-b','--baud', type=int, default=9600,
+            help='serial baud rate')
+    parser.add_argument('-d','--dump', type=argparse.FileType('wb'),
+            help='write the encoded stream to a file instead of a serial port')
+    parser.add_argument('-q','--quiet',action='store_true', default=False,
+            help='suppress output text')
+    args = parser.parse_args()
+    verbose = not args.quiet
+
+    encoder = Encoder()
+    items = []
+    ascii_bytes = 0
+    moves = 0
+    for line in args.gcode_file:
+        ascii_bytes += len(line.strip()) + 1
+        encoded = encoder.encode(line)
+        moves += sum(1 for data, is_packet in encoded if is_packet and data[0] in (PACKET_OP_LINE, PACKET_OP_SEEK, PACKET_OP_LINE_REL))
+        items.extend(encoded)
+    items.extend(encoder.finish())
+    packet_bytes = sum(len(data) for data, is_packet in items)
+    print("Encoded %d g-code bytes into %d bytes, %d packet moves" % (ascii_bytes, packet_bytes, moves))
+
+    if args.dump:
+        for data, is_packet in items:
+            args.dump.write(data)
+        args.dump.close()
+        return
+    if not args.device_file:
+        parser.error('device_file is required unless --dump is given')
+
+    import serial
+    s = serial.Serial(args.device_file, args.baud)
+
+    # Wake up grbl
+    print("Initializing grbl...")
+    s.write(b"\r\n\r\n")
+
+    # Wait for grbl to initialize and flush startup text in serial input
+    time.sleep(2)
+    s.flushInput()
+
+    # Stream with character counting, as stream.py. Grbl switches its receive filter between
+    # g-code lines and raw packets when it executes '$B' or the exit packet, so everything up to
+    # a mode switch must be acknowledged before sending on.
+    print("Streaming %s to %s" % (args.gcode_file.name, args.device_file))
+    c_line = []
+    g_count = [0]
+    def read_response():
+        out_temp = s.readline().strip().decode('ascii', 'replace')
+        if out_temp.find('ok') < 0 and out_temp.find('error') < 0:
+            if verbose: print("  Debug: " + out_temp)
+        else:
+            g_count[0] += 1
+            if verbose or out_temp.find('error') >= 0: print("REC %d: %s" % (g_count[0], out_temp))
+            del c_line[0]
+    for data, is_packet in items:
+        c_line.append(len(data))
+        while sum(c_line) >= RX_BUFFER_SIZE-1 or s.inWaiting():
+            read_response()
+        s.write(data)
+        if data == b'$B\n' or (is_packet and data[0] == PACKET_OP_EXIT):
+            while c_line: read_response()
+    while c_line:
+        read_response()
+
+    print("G-code streaming finished!")
+    s.close()
+
+if __name__ == '__main__':
+    main()
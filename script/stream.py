@@ -2,14 +2,28 @@
 """\
 Stream g-code to grbl controller
 
-This script differs from the simple_stream.py script by 
+This script differs from the simple_stream.py script by
 tracking the number of characters in grbl's serial read
 buffer. This allows grbl to fetch the next line directly
-from the serial buffer and does not have to wait for a 
+from the serial buffer and does not have to wait for a
 response from the computer. This effectively adds another
 buffer layer to prevent buffer starvation.
 
-TODO: - Add runtime command capabilities
+Lines are sent as grbl stores them (comments and spaces
+removed, upper case), so fewer bytes go over the wire. Status
+reports are polled with '?' on a timer while streaming. Grbl
+picks '?' off in the serial interrupt, so it never takes room
+in the read buffer and the character count stays exact. The
+buffer fields of the reports (Buf, RX) set the character
+counting window to the receive buffer grbl was built with and
+reveal planner starvation, when the planner runs empty before
+the program ends. A summary with line and byte rates, the
+starvation events and the total runtime is printed at the end.
+
+Ctrl-C sends a feed hold and stops streaming.
+
+With --loopback, the stream runs against a simulated grbl on a
+pseudo-terminal, which needs neither grbl nor pySerial.
 
   The MIT License (MIT)
   Copyright (c) 2012 Sungeun K. Jeon
@@ -34,76 +48,287 @@ TODO: - Add runtime command capabilities
 
 """
 
-import serial
 import re
+import os
 import time
-import sys
+import select
 import argparse
-# import threading
+import threading
 
 RX_BUFFER_SIZE = 128
 
-# Define command line argument interface
-parser = argparse.ArgumentParser(description='Stream g-code file to grbl. (pySerial and argparse libraries required)')
-parser.add_argument('gcode_file', type=argparse.FileType('r'),
-        help='g-code filename to be streamed')
-parser.add_argument('device_file',
-        help='serial device path')
-parser.add_argument('-q','--quiet',action='store_true', default=False, 
-        help='suppress output text')
-args = parser.parse_args()
-
-# Periodic timer to query for status reports
-# TODO: Need to track down why this doesn't restart consistently before a release.
-# def periodic():
-#     s.write('?')
-#     t = threading.Timer(0.1, periodic) # In seconds
-#     t.start()
-
-# Initialize
-s = serial.Serial(args.device_file,9600)
-f = args.gcode_file
-verbose = True
-if args.quiet : verbose = False
-
-# Wake up grbl
-print "Initializing grbl..."
-s.write("\r\n\r\n")
-
-# Wait for grbl to initialize and flush startup text in serial input
-time.sleep(2)
-s.flushInput()
-
-# Stream g-code to grbl
-print "Streaming ", args.gcode_file.name, " to ", args.device_file
-l_count = 0
-g_count = 0
-c_line = []
-# periodic() # Start status report periodic timer
-for line in f:
-    l_count += 1 # Iterate line counter
-#     l_block = re.sub('\s|\(.*?\)','',line).upper() # Strip comments/spaces/new line and capitalize
-    l_block = line.strip()
-    c_line.append(len(l_block)+1) # Track number of characters in grbl serial read buffer
-    grbl_out = '' 
-    while sum(c_line) >= RX_BUFFER_SIZE-1 | s.inWaiting() :
-        out_temp = s.readline().strip() # Wait for grbl response
-        if out_temp.find('ok') < 0 and out_temp.find('error') < 0 :
-            print "  Debug: ",out_temp # Debug response
-        else :
-            grbl_out += out_temp;
-            g_count += 1 # Iterate g-code counter
-            grbl_out += str(g_count); # Add line finished indicator
-            del c_line[0]
-    if verbose: print "SND: " + str(l_count) + " : " + l_block,
-    s.write(l_block + '\n') # Send block to grbl
-    if verbose : print "BUF:",str(sum(c_line)),"REC:",grbl_out
-
-# Wait for user input after streaming is completed
-print "G-code streaming finished!\n"
-print "WARNING: Wait until grbl completes buffered g-code blocks before exiting."
-raw_input("  Press <Enter> to exit and disable grbl.") 
-
-# Close file and serial port
-f.close()
-s.close()
\ No newline at end of file
+def normalize(line):
+    """Returns the line as grbl's receive filter stores it"""
+    return re.sub(r'\s|\(.*?\)|/', '', line).upper()
+
+def parse_status(text):
+    """Splits a status report, such as '<Run,MPos:1.000,2.000,3.000,Buf:12,RX:96>', into the
+    machine state and a dictionary of its fields, each a list of values"""
+    body = text.strip()[1:-1]
+    state = body.split(',', 1)[0]
+    fields = {}
+    for name, values in re.findall(r'([A-Za-z]+):([^:]*?)(?=,[A-Za-z]+:|$)', body):
+        fields[name] = values.split(',')
+    return state, fields
+
+class SerialPort:
+    """pySerial device with the small interface the streamer uses"""
+    def __init__(self, device_file, baud):
+        import serial
+        self.s = serial.Serial(device_file, baud, timeout=0.01)
+
+    def write(self, data):
+        self.s.write(data)
+
+    def read(self):
+        return self.s.read(max(1, self.s.inWaiting()))
+
+    def flush_input(self):
+        self.s.flushInput()
+
+    def close(self):
+        self.s.close()
+
+class PtyPort:
+    """Pseudo-terminal file descriptor with the interface of SerialPort"""
+    def __init__(self, fd):
+        self.fd = fd
+
+    def write(self, data):
+        while data:
+            data = data[os.write(self.fd, data):]
+
+    def read(self, timeout=0.01):
+        if not select.select([self.fd], [], [], timeout)[0]: return b''
+        return os.read(self.fd, 1024)
+
+    def flush_input(self):
+        while self.read(0): pass
+
+    def close(self):
+        os.close(self.fd)
+
+class SimulatedGrbl(threading.Thread):
+    """Minimal grbl on the other end of a pseudo-terminal for testing the streamer. Lines are
+    taken from a receive buffer of rx_buffer_size bytes into a planner of planner_size blocks,
+    which retires a block every block_time seconds. '?' is answered at once, never buffered."""
+    def __init__(self, port, rx_buffer_size=RX_BUFFER_SIZE, planner_size=18, block_time=0.005):
+        threading.Thread.__init__(self)
+        self.daemon = True
+        self.port = port
+        self.rx_size = rx_buffer_size
+        self.planner_free_max = planner_size-1
+        self.planner_free = self.planner_free_max
+        self.block_time = block_time
+        self.overflows = 0
+
+    def run(self):
+        rx = bytearray()
+        next_retire = time.time()
+        while True:
+            try: received = self.port.read(0.001)
+            except OSError: return # Streamer closed the port
+            for c in bytearray(received):
+                if c == ord('?'):
+                    state = 'Idle' if self.planner_free == self.planner_free_max else 'Run'
+                    self.port.write(('<%s,MPos:0.000,0.000,0.000,Buf:%d,RX:%d>\r\n' %
+                        (state, self.planner_free, self.rx_size-1-len(rx))).encode('ascii'))
+                elif c == ord('\r'):
+                    pass
+                elif len(rx) < self.rx_size-1:
+                    rx.append(c)
+                else:
+                    self.overflows += 1 # The streamer sent more than fits
+            now = time.time()
+            if self.planner_free == self.planner_free_max: next_retire = now + self.block_time
+            while self.planner_free < self.planner_free_max and now >= next_retire:
+                self.planner_free += 1
+                next_retire += self.block_time
+            while b'\n' in rx and self.planner_free > 0:
+                line, rx = rx.split(b'\n', 1)
+                if line: self.planner_free -= 1
+                self.port.write(b'ok\r\n')
+
+class Streamer:
+    """Streams lines with character counting, polls status reports and collects statistics"""
+    def __init__(self, port, rx_buffer_size=None, poll_interval=0.2, verbose=True):
+        self.port = port
+        self.rx_buffer_size = rx_buffer_size or RX_BUFFER_SIZE
+        self.learn_rx_size = rx_buffer_size is None
+        self.poll_interval = poll_interval
+        self.verbose = verbose
+        self.received = b''
+        self.c_line = []          # Lengths of the lines in grbl's receive buffer, oldest first
+        self.l_sent = []          # File line numbers of those lines
+        self.next_poll = time.time()
+        self.state = None
+        self.planner_free = None
+        self.planner_free_max = None
+        self.planner_primed = False # Planner held blocks since it last ran empty
+        self.streaming = False
+        self.starvations = 0
+        self.errors = []
+        self.acked = 0
+
+    def poll(self):
+        """Requests a status report when due"""
+        if not self.poll_interval: return
+        now = time.time()
+        if now >= self.next_poll:
+            self.port.write(b'?')
+            self.next_poll = now + self.poll_interval
+
+    def on_status(self, text):
+        self.state, fields = parse_status(text)
+        if 'RX' in fields and self.learn_rx_size and not self.c_line:
+            # Nothing in flight, so the free bytes are the whole buffer, less its unused byte.
+            self.rx_buffer_size = int(fields['RX'][0]) + 1
+            self.learn_rx_size = False
+        if 'Buf' in fields:
+            self.planner_free = int(fields['Buf'][0])
+            if self.planner_free_max is None or self.planner_free > self.planner_free_max:
+                self.planner_free_max = self.planner_free
+            if self.planner_free < self.planner_free_max:
+                self.planner_primed = True
+            elif self.planner_primed and self.streaming:
+                # Planner ran empty while the program still had lines to go.
+                self.starvations += 1
+                self.planner_primed = False
+                if self.verbose: print("  Starved: planner empty, RX:%s" % fields.get('RX', ['?'])[0])
+        if self.verbose: print("  Status: " + text)
+
+    def on_response(self, text):
+        self.acked += 1
+        l_count = self.l_sent.pop(0)
+        del self.c_line[0]
+        if text.startswith('error'): self.errors.append((l_count, text))
+        if self.verbose or text.startswith('error'): print("REC %d: %s" % (l_count, text))
+
+    def service(self):
+        """Handles everything received so far and sends a poll when due"""
+        self.poll()
+        self.received += self.port.read()
+        while b'\n' in self.received:
+            out, self.received = self.received.split(b'\n', 1)
+            out = out.strip().decode('ascii', 'replace')
+            if not out: continue
+            if out.startswith('<') and out.endswith('>'): self.on_status(out)
+            elif (out.startswith('ok') or out.startswith('error')) and self.c_line: self.on_response(out)
+            elif self.verbose: print("  Debug: " + out)
+
+    def wait_for_status(self, timeout=2.0):
+        """Polls one status report, so the window is known before streaming. Returns False, if
+        grbl sent none, such as with the buffer fields or polling disabled."""
+        if not self.poll_interval: return False
+        end = time.time() + timeout
+        self.next_poll = time.time()
+        self.state = None
+        while self.state is None and time.time() < end: self.service()
+        return self.state is not None
+
+    def stream(self, lines):
+        """Sends (file line number, block) pairs, keeping grbl's receive buffer full"""
+        self.streaming = True
+        self.bytes_sent = 0
+        for l_count, block in lines:
+            data = (block + '\n').encode('ascii')
+            while self.c_line and sum(self.c_line) + len(data) > self.rx_buffer_size-1:
+                self.service()
+            self.c_line.append(len(data))
+            self.l_sent.append(l_count)
+            self.port.write(data)
+            self.bytes_sent += len(data)
+            if self.verbose: print("SND %d: %s BUF:%d" % (l_count, block, sum(self.c_line)))
+            self.service()
+        self.streaming = False
+        while self.c_line: self.service()
+
+    def wait_until_idle(self):
+        """Polls until grbl is idle with an empty planner. Returns False, if polling is disabled."""
+        if not self.poll_interval: return False
+        self.state = None
+        self.planner_free = None
+        while not (self.state == 'Idle' and self.planner_free in (None, self.planner_free_max)):
+            self.service()
+        return True
+
+def main():
+    parser = argparse.ArgumentParser(description='Stream g-code file to grbl. (pySerial and argparse libraries required)')
+    parser.add_argument('gcode_file', type=argparse.FileType('r'),
+            help='g-code filename to be streamed')
+    parser.add_argument('device_file', nargs='?',
+            help='serial device path')
+    parser.add_argument('-b','--baud', type=int, default=9600,
+            help='serial baud rate')
+    parser.add_argument('-r','--rx-buffer-size', type=int,
+            help='grbl serial receive buffer size. Default: from the first status report, else %d' % RX_BUFFER_SIZE)
+    parser.add_argument('-p','--poll', type=float, default=0.2,
+            help='status report interval in seconds, 0 to disable')
+    parser.add_argument('-l','--loopback', action='store_true', default=False,
+            help='stream to a simulated grbl on a pseudo-terminal instead of a device')
+    parser.add_argument('-q','--quiet',action='store_true', default=False,
+            help='suppress output text')
+    args = parser.parse_args()
+    verbose = not args.quiet
+
+    if args.loopback:
+        import tty
+        master, slave = os.openpty()
+        tty.setraw(slave)
+        simulator = SimulatedGrbl(PtyPort(master))
+        simulator.start()
+        port = PtyPort(slave)
+        device = os.ttyname(slave)
+    elif args.device_file:
+        port = SerialPort(args.device_file, args.baud)
+        device = args.device_file
+    else:
+        parser.error('device_file is required unless --loopback is given')
+
+    lines = []
+    for l_count, line in enumerate(args.gcode_file, 1):
+        block = normalize(line)
+        if block: lines.append((l_count, block))
+
+    # Wake up grbl
+    print("Initializing grbl...")
+    port.write(b"\r\n\r\n")
+
+    # Wait for grbl to initialize and flush startup text in serial input
+    if not args.loopback: time.sleep(2)
+    port.flush_input()
+
+    streamer = Streamer(port, args.rx_buffer_size, args.poll, verbose)
+    if not streamer.wait_for_status() and args.poll:
+        print("No status report. Character counting with %d bytes." % streamer.rx_buffer_size)
+
+    print("Streaming %s to %s" % (args.gcode_file.name, device))
+    start = time.time()
+    try:
+        streamer.stream(lines)
+        stream_time = time.time() - start
+        idle = streamer.wait_until_idle()
+    except KeyboardInterrupt:
+        port.write(b'!')
+        print("Feed hold sent. Streaming stopped after %d of %d lines." % (streamer.acked, len(lines)))
+        port.close()
+        return
+    runtime = time.time() - start
+
+    print("G-code streaming finished!")
+    print("  Lines: %d in %.2f s, %.1f lines/s, %.0f bytes/s" % (len(lines), stream_time,
+        len(lines)/max(stream_time, 1e-6), streamer.bytes_sent/max(stream_time, 1e-6)))
+    if streamer.planner_free_max is not None:
+        print("  Planner starvation events: %d" % streamer.starvations)
+    else:
+        print("  Planner starvation events: unknown, no Buf field in status reports")
+    if idle: print("  Total runtime: %.2f s" % runtime)
+    else: print("  WARNING: Wait until grbl completes buffered g-code blocks before exiting.")
+    if args.loopback: print("  Simulated receive buffer overflows: %d" % simulator.overflows)
+    print("  Errors: %d" % len(streamer.errors))
+    for l_count, text in streamer.errors: print("    Line %d: %s" % (l_count, text))
+    args.gcode_file.close()
+    port.close()
+
+if __name__ == '__main__':
+    main()
@@ -47,6 +47,7 @@
 */
 
 #include <avr/interrupt.h>
+#include <math.h>
 #include "serial.h"
 #include "config.h"
 #include "motion_control.h"
@@ -56,39 +57,101 @@ uint8_t rx_buffer[RX_BUFFER_SIZE];
 uint8_t rx_buffer_head = 0;
 volatile uint8_t rx_buffer_tail = 0;
 
+// Line assembly. The RX interrupt filters the incoming characters and stores only complete,
+// normalized lines, each terminated by a zero, so the main program never handles whitespace or
+// comments and fetches whole lines at once. In raw mode, bytes are stored unfiltered instead.
+static volatile uint8_t rx_line_count = 0; // Number of complete lines in the RX buffer
+static uint8_t rx_line_length = 0;         // Characters stored of the line being received
+static uint8_t rx_iscomment = false;       // Comment flag to ignore characters until ')' or EOL
+static uint8_t rx_overflow = false;        // Line overflow flag to ignore characters until EOL
+static volatile uint8_t rx_raw_mode = false;
+
 uint8_t tx_buffer[TX_BUFFER_SIZE];
 uint8_t tx_buffer_head = 0;
 volatile uint8_t tx_buffer_tail = 0;
+static uint8_t tx_line_start = true; // Last byte sent from tx_buffer ended a line. Used by the TX interrupt.
+
+// High-priority status frame. A real-time status report is composed here in full and then sent by
+// the TX interrupt ahead of the regular output, as soon as the line being sent is complete. So a
+// status report never waits behind a long response and never splits one of its lines.
+#define TX_STATUS_IDLE      0 // Empty. A new report may be composed.
+#define TX_STATUS_COMPOSING 1 // serial_write() stores here instead of in tx_buffer.
+#define TX_STATUS_READY     2 // Complete. Being sent by the TX interrupt.
+static uint8_t tx_status_buffer[TX_STATUS_BUFFER_SIZE];
+static uint8_t tx_status_length;
+static volatile uint8_t tx_status_index;  // Next byte to send. Updated by the TX interrupt.
+static volatile uint8_t tx_status_state = TX_STATUS_IDLE;
+static uint8_t tx_status_overflow;
 
 #ifdef ENABLE_XONXOFF
 	volatile uint8_t flow_ctrl = XON_SENT;	// Flow control state variable
 											//
-	// Returns the number of bytes in the RX buffer. This replaces a typical byte counter to prevent
-	// the interrupt and main programs from writing to the counter at the same time.
-	static uint8_t get_rx_buffer_count()
-	{
-		if (rx_buffer_head == rx_buffer_tail) { return(0); }
-		if (rx_buffer_head < rx_buffer_tail) { return(rx_buffer_tail-rx_buffer_head); }
-		return (RX_BUFFER_SIZE - (rx_buffer_head-rx_buffer_tail));
-	}
 #endif
 
-void serial_init()
+// Returns the number of bytes in the RX buffer. This replaces a typical byte counter to prevent
+// the interrupt and main programs from writing to the counter at the same time.
+static uint8_t get_rx_buffer_count()
 {
-	// Set baud rate
-#if BAUD_RATE < 57600
-	//计算波特率寄存器UBRR的值
-	uint16_t UBRR0_value = ((F_CPU / (8L * BAUD_RATE)) - 1)/2;
-	//使用同步操作将此位置0,倍速发送功能关闭
-	UCSR0A &= ~(1 << U2X0); // baud doubler off  - Only needed on Uno XXX
-#else
-	uint16_t UBRR0_value = ((F_CPU / (4L * BAUD_RATE)) - 1)/2;
-	UCSR0A |= (1 << U2X0);  // baud doubler on for high baud rates, i.e. 115200
-#endif
+	uint8_t head = rx_buffer_head; // Copy once. May be updated by the RX interrupt.
+	uint8_t tail = rx_buffer_tail;
+	if (head >= tail) { return(head-tail); }
+	return (RX_BUFFER_SIZE - (tail-head));
+}
+
+// Returns the number of free bytes in the RX buffer. One byte always stays unused to tell a full
+// buffer from an empty one.
+uint8_t serial_get_rx_buffer_available()
+{
+	return(RX_BUFFER_SIZE-1 - get_rx_buffer_count());
+}
+
+// Computes UBRR0 for the baud rate in normal (u2x false) or double speed mode. Returns the error
+// of the resulting baud rate in percent.
+float serial_baud_error(uint32_t baud_rate, uint8_t u2x, uint16_t *ubrr)
+{
+	uint32_t divisor = (u2x ? 8 : 16)*baud_rate;
+	uint32_t count = (F_CPU + divisor/2)/divisor; // UBRR0+1, rounded to nearest
+	if (count < 1) { count = 1; }
+	if (count > 4096) { count = 4096; } // UBRR0 is 12 bits
+	*ubrr = count-1;
+	return(100.0*F_CPU/((float)divisor*count) - 100.0);
+}
+
+// Programs the baud rate with the U2X mode giving the lowest error. Normal speed is preferred on a
+// tie, since its receiver samples more often and tolerates more error and noise. Output still
+// pending is sent at the previous baud rate first.
+void serial_set_baud_rate(uint32_t baud_rate)
+{
+	static uint32_t current_baud_rate = 0;
+	if (baud_rate == current_baud_rate) { return; }
+	if (current_baud_rate)
+	{
+		while (UCSR0B & (1 << UDRIE0)) { } // Wait for the TX interrupt to empty the buffers.
+		delay_us(20000000/current_baud_rate); // Let the last two characters leave the shift registers.
+	}
+	current_baud_rate = baud_rate;
+
+	uint16_t UBRR0_value, UBRR0_u2x;
+	if (fabs(serial_baud_error(baud_rate, true, &UBRR0_u2x)) < fabs(serial_baud_error(baud_rate, false, &UBRR0_value)))
+	{
+		UBRR0_value = UBRR0_u2x;
+		UCSR0A |= (1 << U2X0);  // baud doubler on
+	}
+	else
+	{
+		//使用同步操作将此位置0,倍速发送功能关闭
+		UCSR0A &= ~(1 << U2X0); // baud doubler off  - Only needed on Uno XXX
+	}
 	// Set baud rate
 	//设置波特率的高8位与低8位,将数据存入波特率寄存器UBRR中
 	UBRR0H = UBRR0_value >> 8;
 	UBRR0L = UBRR0_value;
+}
+
+void serial_init()
+{
+	// Set the compiled baud rate. The baud rate setting is applied by the reset in main().
+	serial_set_baud_rate(BAUD_RATE);
 	        
 	// enable rx and tx
 	//接收与发送中断使能
@@ -104,6 +167,14 @@ void serial_init()
 
 void serial_write(uint8_t data)
 {
+	// Store in the status frame while a status report is being composed. Never waits.
+	if (tx_status_state == TX_STATUS_COMPOSING)
+	{
+		if (tx_status_length < TX_STATUS_BUFFER_SIZE) { tx_status_buffer[tx_status_length++] = data; }
+		else { tx_status_overflow = true; }
+		return;
+	}
+
 	// Calculate next head
 	uint8_t next_head = tx_buffer_head + 1;
 	if(next_head == TX_BUFFER_SIZE){next_head = 0;}
@@ -113,6 +184,7 @@ void serial_write(uint8_t data)
 	while(next_head == tx_buffer_tail)
 	{ 
 		if(sys.execute & EXEC_RESET){return;} // Only check for abort to avoid an endless loop.
+		protocol_execute_background(); // Keep motion and status reports going during long responses.
 	}
 
 	// Store data and advance head
@@ -123,11 +195,38 @@ void serial_write(uint8_t data)
 	UCSR0B |= (1 << UDRIE0);
 }
 
+// Starts composing a real-time status report in the high-priority status frame. Returns false
+// while the previous report is still being sent.
+uint8_t serial_status_begin()
+{
+	if (tx_status_state != TX_STATUS_IDLE) { return(false); }
+	tx_status_length = 0;
+	tx_status_overflow = false;
+	tx_status_state = TX_STATUS_COMPOSING;
+	return(true);
+}
+
+// Completes the status report and hands it to the TX interrupt. Returns false and discards the
+// report, if it did not fit into the status frame.
+uint8_t serial_status_end()
+{
+	if (tx_status_overflow || tx_status_length == 0)
+	{
+		tx_status_state = TX_STATUS_IDLE;
+		return(false);
+	}
+	tx_status_index = 0;
+	tx_status_state = TX_STATUS_READY;
+	UCSR0B |= (1 << UDRIE0);
+	return(true);
+}
+
 // Data Register Empty Interrupt handler
 ISR(SERIAL_UDRE)
 {
 	// Temporary tx_buffer_tail (to optimize for volatile)
 	uint8_t tail = tx_buffer_tail;
+	uint8_t status_index = tx_status_index;
 
 #ifdef ENABLE_XONXOFF
 	if(flow_ctrl == SEND_XOFF)
@@ -142,16 +241,59 @@ ISR(SERIAL_UDRE)
 	}
 	else
 #endif
+	if (tx_status_state == TX_STATUS_READY && (status_index || tx_line_start))
+	{
+		// Send the status frame first, once the regular output is between lines.
+		UDR0 = tx_status_buffer[status_index];
+		status_index++;
+		if (status_index == tx_status_length)
+		{
+			status_index = 0;
+			tx_status_state = TX_STATUS_IDLE;
+		}
+		tx_status_index = status_index;
+	}
+	else if (tail != tx_buffer_head)
 	{ 
 		// Send a byte from the buffer	
+		tx_line_start = (tx_buffer[tail] == '\n');
 		UDR0 = tx_buffer[tail];
 		// Update tail position
 		tail++;
 		if(tail == TX_BUFFER_SIZE){tail = 0;}
 		tx_buffer_tail = tail;
 	}  
- 	// Turn off Data Register Empty Interrupt to stop tx-streaming if this concludes the transfer
- 	if(tail == tx_buffer_head) { UCSR0B &= ~(1 << UDRIE0); }
+ 	// Turn off Data Register Empty Interrupt to stop tx-streaming if this concludes the transfer.
+	// Also while the status frame waits for the rest of a line that is still to be written.
+ 	if (tail == tx_buffer_head && !(tx_status_state == TX_STATUS_READY && (status_index || tx_line_start)))
+	{
+		UCSR0B &= ~(1 << UDRIE0);
+	}
+}
+
+// Copies the next complete line from the RX buffer into line, zero-terminated. Returns false when
+// no complete line has been received yet. 
+uint8_t serial_read_line(char *line)
+{
+	if (!rx_line_count) { return(false); }
+	uint8_t tail = rx_buffer_tail; // Temporary rx_buffer_tail (to optimize for volatile)
+	do {
+		*line = rx_buffer[tail];
+		tail++;
+		if(tail == RX_BUFFER_SIZE){tail = 0;}
+	} while (*(line++) != 0);
+	rx_buffer_tail = tail;
+	cli(); rx_line_count--; sei();
+
+  #ifdef ENABLE_XONXOFF
+	if((get_rx_buffer_count() < RX_BUFFER_LOW) && flow_ctrl == XOFF_SENT)
+	{ 
+		flow_ctrl = SEND_XON;
+		UCSR0B |=  (1 << UDRIE0); // Force TX
+	}
+  #endif
+
+	return(true);
 }
 
 uint8_t serial_read()
@@ -180,10 +322,49 @@ uint8_t serial_read()
 	}
 }
 
+// Writes a byte to the RX buffer, unless it is full. Returns false, if full.
+static uint8_t rx_buffer_put(uint8_t data)
+{
+	uint8_t next_head = rx_buffer_head + 1;
+	if(next_head == RX_BUFFER_SIZE){next_head = 0;}
+	if(next_head == rx_buffer_tail) { return(false); }
+
+	rx_buffer[rx_buffer_head] = data;
+	rx_buffer_head = next_head;    
+
+#ifdef ENABLE_XONXOFF
+	if ((get_rx_buffer_count() >= RX_BUFFER_FULL) && flow_ctrl == XON_SENT)
+	{
+		flow_ctrl = SEND_XOFF;
+		UCSR0B |=  (1 << UDRIE0); // Force TX
+	} 
+#endif
+	return(true);
+}
+
+// Removes the stored part of the line being received. The main program only reads complete lines,
+// so the partial line at the head is safe to rewind.
+static void rx_line_rewind()
+{
+	int16_t head = rx_buffer_head - rx_line_length;
+	if (head < 0) { head += RX_BUFFER_SIZE; }
+	rx_buffer_head = head;
+	rx_line_length = 0;
+}
+
+// Replaces the stored part of the line being received with the overflow marker and ignores the
+// rest of it. Used for lines too long for the line buffer and lines that lost a byte to a full RX
+// buffer, so a damaged line is reported instead of executed.
+static void rx_line_overflow()
+{
+	rx_line_rewind();
+	if (rx_buffer_put(SERIAL_LINE_OVERFLOW)) { rx_line_length = 1; }
+	rx_overflow = true;
+}
+
 ISR(SERIAL_RX)
 {
 	uint8_t data = UDR0;
-	uint8_t next_head;
 
 	// Pick off runtime command characters directly from the serial stream. These characters are
 	// not passed into the buffer, but these set system state flag bits for runtime execution.
@@ -193,31 +374,68 @@ ISR(SERIAL_RX)
 		case CMD_CYCLE_START:   sys.execute |= EXEC_CYCLE_START; break; // Set as true
 		case CMD_FEED_HOLD:     sys.execute |= EXEC_FEED_HOLD; break; // Set as true
 		case CMD_RESET:         mc_reset(); break; // Call motion control reset routine.
-		default: // Write character to buffer    
-			next_head = rx_buffer_head + 1;
-			if(next_head == RX_BUFFER_SIZE){next_head = 0;}
-
-			// Write data to buffer unless it is full.
-			if(next_head != rx_buffer_tail)
+		case CMD_JOG_CANCEL:    // A feed hold during a jog cancels it. No effect otherwise.
+			if (sys.state == STATE_JOG) { sys.execute |= EXEC_FEED_HOLD; }
+			break;
+		default: 
+			if (rx_raw_mode) 
 			{
-				rx_buffer[rx_buffer_head] = data;
-				rx_buffer_head = next_head;    
-
-#ifdef ENABLE_XONXOFF
-				if ((get_rx_buffer_count() >= RX_BUFFER_FULL) && flow_ctrl == XON_SENT)
-				{
-					flow_ctrl = SEND_XOFF;
-					UCSR0B |=  (1 << UDRIE0); // Force TX
-				} 
-#endif
+				rx_buffer_put(data);
+			}
+			else if ((data == '\n') || (data == '\r'))  // End of line reached
+			{
+				// Empty and comment lines are stored too, so each is still acknowledged for syncing.
+				if (rx_buffer_put(0)) { rx_line_count++; }
+				else { rx_line_rewind(); } // No room to terminate. Drop the line rather than merge it.
+				rx_line_length = 0;
+				rx_iscomment = false;
+				rx_overflow = false;
+			}
+			else if (rx_iscomment)
+			{
+				// Throw away all comment characters
+				if (data == ')') { rx_iscomment = false; } // End of comment. Resume line.
+			}
+			else if (rx_overflow || (data <= ' ') || (data == '/'))
+			{ 
+				// Throw away the rest of an overflowed line, whitespace and control characters. Block
+				// delete is not supported. Ignore character.
+			}
+			else if (data == '(')
+			{
+				// Enable comments flag and ignore all characters until ')' or EOL.
+				rx_iscomment = true;
+			}
+			else if (rx_line_length >= LINE_BUFFER_SIZE-1)
+			{
+				rx_line_overflow(); // Line too long for the line buffer
+			}
+			else
+			{
+				if (data >= 'a' && data <= 'z') { data -= 'a'-'A'; } // Upcase lowercase
+				if (rx_buffer_put(data)) { rx_line_length++; }
+				else { rx_line_overflow(); } // RX buffer full. Byte lost.
 			}
 			break;
 	}
 }
 
+// Switches line assembly in the RX interrupt off (true) or on (false). In raw mode, all bytes
+// other than runtime commands are stored as received and are read with serial_read().
+void serial_set_raw_mode(uint8_t enable)
+{
+	rx_raw_mode = enable;
+}
+
 void serial_reset_read_buffer() 
 {
+	cli();
 	rx_buffer_tail = rx_buffer_head;
+	rx_line_count = 0;
+	rx_line_length = 0;
+	rx_iscomment = false;
+	rx_overflow = false;
+	sei();
 
 #ifdef ENABLE_XONXOFF
 	flow_ctrl = XON_SENT;
@@ -38,8 +38,12 @@
 #ifndef TX_BUFFER_SIZE
   #define TX_BUFFER_SIZE 64
 #endif
+#ifndef TX_STATUS_BUFFER_SIZE
+  #define TX_STATUS_BUFFER_SIZE 64
+#endif
 
 #define SERIAL_NO_DATA 0xff
+#define SERIAL_LINE_OVERFLOW 0x01 // Stored in place of a line too long for LINE_BUFFER_SIZE
 
 #ifdef ENABLE_XONXOFF
   #define RX_BUFFER_FULL 96 // XOFF high watermark
@@ -52,12 +56,41 @@
   #define XON_CHAR 0x11
 #endif
 
+// Largest accepted baud rate error in percent. The receiver tolerates about 4.5% for 8N1, which
+// leaves a little margin for the error of the host clock.
+#ifndef SERIAL_BAUD_MAX_ERROR
+  #define SERIAL_BAUD_MAX_ERROR 4.0
+#endif
+
 void serial_init();
 
+// Switches to the baud rate, with the U2X mode giving the lowest error, after sending any pending
+// output. Does nothing, if the baud rate is unchanged.
+void serial_set_baud_rate(uint32_t baud_rate);
+
+// Computes UBRR0 for the baud rate in normal or double speed (u2x) mode and returns its error in
+// percent.
+float serial_baud_error(uint32_t baud_rate, uint8_t u2x, uint16_t *ubrr);
+
 void serial_write(uint8_t data);
 
+// Redirects serial_write() into the high-priority status frame, which is sent ahead of the regular
+// output. Begin returns false while the previous frame is still being sent. End returns false if
+// the frame overflowed and was discarded.
+uint8_t serial_status_begin();
+uint8_t serial_status_end();
+
 uint8_t serial_read();
 
+// Returns the number of free bytes in the RX buffer.
+uint8_t serial_get_rx_buffer_available();
+
+// Fetches the next complete, filtered line. Returns false, if none has been received yet.
+uint8_t serial_read_line(char *line);
+
+// Turns the line filter of the RX interrupt off for raw byte input, or back on.
+void serial_set_raw_mode(uint8_t enable);
+
 // Reset and empty data in read buffer. Used by e-stop and reset.
 void serial_reset_read_buffer();
 
@@ -28,6 +28,7 @@
 */
 
 #include <avr/io.h>
+#include <stddef.h>
 #include "protocol.h"
 #include "report.h"
 #include "stepper.h"
@@ -35,8 +36,34 @@
 #include "settings.h"
 #include "eeprom.h"
 #include "limits.h"
+#include "serial.h"
 
 settings_t settings;
+static uint8_t settings_profile; // Index of the active settings profile
+
+// RAM copy of all coordinate systems, the G28/G30 home positions, the G92 offset and the parked
+// position. Loaded and validated once at settings_init(), so coordinate system selection and
+// G28/G30 never touch the EEPROM at runtime. Writes update the RAM copy and flag the record dirty.
+// The dirty records are appended to the journal one byte at a time by settings_sync_coord_data(),
+// only when the EEPROM write queue has room.
+#define N_COORD_RECORDS    (SETTING_INDEX_PARK+1)
+#define JOURNAL_NO_SLOT    0xff
+
+typedef struct {
+	uint16_t sequence;         // Increments with each entry. The highest valid one is the newest.
+	uint8_t  record;           // Coordinate record index
+	float    coord[N_AXIS];
+} journal_entry_t;
+
+static float coord_table[N_COORD_RECORDS][N_AXIS];
+static uint16_t coord_dirty;   // Bit flags of records still to be written back
+static uint8_t record_slot[N_COORD_RECORDS]; // Journal slot holding the newest copy of each record
+static uint16_t journal_sequence;            // Sequence number of the next entry
+static uint8_t journal_next;                 // Slot to try first for the next entry
+static char sync_record[JOURNAL_SLOT_SIZE];  // Entry being written back, packed as a record
+static uint8_t sync_coord_select;            // Coordinate record of the entry being written back
+static uint8_t sync_slot;      // Journal slot of the entry being written back
+static uint8_t sync_index;     // Next byte of the entry to write. Zero when idle.
 
 // Version 4 outdated settings record
 // 老版本V4的参数设定
@@ -56,24 +83,145 @@ typedef struct {
 // Method to store startup lines into EEPROM
 void settings_store_startup_line(uint8_t n, char *line)
 {
-	uint16_t addr = n*(LINE_BUFFER_SIZE+1)+EEPROM_ADDR_STARTUP_BLOCK;
-	memcpy_to_eeprom_with_checksum(addr,(char*)line, LINE_BUFFER_SIZE);
+	uint16_t addr = n*EEPROM_RECORD_SIZE(LINE_BUFFER_SIZE)+EEPROM_ADDR_STARTUP_BLOCK;
+	eeprom_write_record(addr, STARTUP_LINE_VERSION, (char*)line, LINE_BUFFER_SIZE);
 }
 
-// Method to store coord data parameters into EEPROM
+// Method to store coord data parameters. Updates the RAM copy and queues the record for EEPROM
+// write-back, unless it is unchanged.
 // 将坐标系数据存入EEPROM中
 void settings_write_coord_data(uint8_t coord_select, float *coord_data)
 {  
-	uint16_t addr = coord_select*(sizeof(float)*N_AXIS+1) + EEPROM_ADDR_PARAMETERS;
-	memcpy_to_eeprom_with_checksum(addr,(char*)coord_data, sizeof(float)*N_AXIS);
+	if (!memcmp(coord_table[coord_select], coord_data, sizeof(float)*N_AXIS)) { return; }
+	memcpy(coord_table[coord_select], coord_data, sizeof(float)*N_AXIS);
+	coord_dirty |= bit(coord_select);
 }  
 
-// Method to store Grbl global settings struct and version number into EEPROM
+// Returns the first journal slot from journal_next on, which holds no newest copy of a record.
+// Overwriting only such slots keeps every record recoverable, even if power fails mid-write. There
+// are always free slots, since there are far more slots than records.
+static uint8_t journal_free_slot()
+{
+	uint8_t slot = journal_next;
+	uint8_t i = 0;
+	while (i < N_COORD_RECORDS)
+	{
+		if (record_slot[i] == slot)
+		{
+			if (++slot == JOURNAL_SLOTS) { slot = 0; }
+			i = 0; // Check the new slot against all records.
+		}
+		else { i++; }
+	}
+	return(slot);
+}
+
+// Queues the next byte of the journal entry being written back, starting a new entry for the next
+// dirty record if none is. A record is copied when its entry starts, so a record changed mid-write
+// is still stored consistently and is then written again.
+static void journal_sync_byte()
+{
+	if (sync_index == 0)
+	{
+		if (!coord_dirty) { return; }
+		journal_entry_t entry;
+		sync_coord_select = 0;
+		while (bit_isfalse(coord_dirty,bit(sync_coord_select))) { sync_coord_select++; }
+		coord_dirty &= ~bit(sync_coord_select);
+		entry.sequence = journal_sequence;
+		entry.record = sync_coord_select;
+		memcpy(entry.coord, coord_table[sync_coord_select], sizeof(float)*N_AXIS);
+		eeprom_pack_record(sync_record, JOURNAL_VERSION, (char*)&entry, sizeof(journal_entry_t));
+		sync_slot = journal_free_slot();
+	}
+	eeprom_put_char(EEPROM_ADDR_JOURNAL + sync_slot*JOURNAL_SLOT_SIZE + sync_index, sync_record[sync_index]);
+	sync_index++;
+	if (sync_index == EEPROM_RECORD_SIZE(sizeof(journal_entry_t)))
+	{
+		// Entry complete. Its slot now holds the newest copy, which frees the previous one.
+		sync_index = 0;
+		record_slot[sync_coord_select] = sync_slot;
+		journal_sequence++;
+		journal_next = sync_slot+1;
+		if (journal_next == JOURNAL_SLOTS) { journal_next = 0; }
+	}
+}
+
+// Appends dirty coordinate records to the journal without blocking. Each call queues at most one
+// byte and returns right away if the EEPROM write queue is full, so it is safe to call from the
+// runtime command check points while in motion.
+void settings_sync_coord_data()
+{
+	if (eeprom_is_ready()) { journal_sync_byte(); }
+}
+
+// Writes all dirty coordinate records to the journal, waiting for the EEPROM write queue as needed.
+// Also works with interrupts disabled, such as during startup.
+static void journal_flush()
+{
+	while (coord_dirty || sync_index) { journal_sync_byte(); }
+}
+
+// Scans the journal at startup and loads the newest valid copy of each record into the RAM copy.
+// Entries cut short by a power loss fail their CRC and are skipped, leaving the previous copy
+// in effect. Sequence numbers are compared by their difference, so they may wrap around.
+static void journal_scan()
+{
+	journal_entry_t entry;
+	uint16_t record_sequence[N_COORD_RECORDS];
+	uint8_t newest_slot = JOURNAL_NO_SLOT;
+	uint8_t slot;
+	memset(record_slot, JOURNAL_NO_SLOT, sizeof(record_slot));
+	journal_sequence = 0;
+	journal_next = 0;
+	for (slot=0; slot<JOURNAL_SLOTS; slot++)
+	{
+		uint16_t addr = EEPROM_ADDR_JOURNAL + slot*JOURNAL_SLOT_SIZE;
+		if (!eeprom_read_record((char*)&entry, addr, JOURNAL_VERSION, sizeof(journal_entry_t))) { continue; }
+		if (entry.record >= N_COORD_RECORDS) { continue; }
+		if (record_slot[entry.record] == JOURNAL_NO_SLOT || 
+		    (int16_t)(entry.sequence - record_sequence[entry.record]) > 0)
+		{
+			record_slot[entry.record] = slot;
+			record_sequence[entry.record] = entry.sequence;
+			memcpy(coord_table[entry.record], entry.coord, sizeof(float)*N_AXIS);
+		}
+		// Continue after the newest entry of all.
+		if (newest_slot == JOURNAL_NO_SLOT || (int16_t)(entry.sequence - journal_sequence) >= 0)
+		{
+			newest_slot = slot;
+			journal_sequence = entry.sequence+1;
+		}
+	}
+	if (newest_slot != JOURNAL_NO_SLOT && newest_slot+1 < JOURNAL_SLOTS) { journal_next = newest_slot+1; }
+}
+
+// Returns the EEPROM address of a settings profile record.
+static uint16_t profile_address(uint8_t n)
+{
+	if (n == 0) { return(EEPROM_ADDR_GLOBAL); }
+	return(EEPROM_ADDR_PROFILES + (n-1)*EEPROM_RECORD_SIZE(sizeof(settings_t)));
+}
+
+// Method to store Grbl global settings struct and version number into EEPROM. Stores the active
+// settings profile.
 // 将全局变量参数与版本信息存储于EEPROM中
 void write_global_settings() 
 {
-	eeprom_put_char(0, SETTINGS_VERSION);
-	memcpy_to_eeprom_with_checksum(EEPROM_ADDR_GLOBAL, (char*)&settings, sizeof(settings_t));
+	eeprom_update_char(0, SETTINGS_VERSION);
+	eeprom_write_record(profile_address(settings_profile), SETTINGS_VERSION, (char*)&settings, sizeof(settings_t));
+}
+
+// Sets the per-axis homing rates and pull-offs of all axes to the common homing settings.
+static void copy_axis_homing_settings()
+{
+	uint8_t idx;
+	for (idx=0; idx<N_AXIS; idx++)
+	{
+		settings.homing_axis_feed_rate[idx] = settings.homing_feed_rate;
+		settings.homing_axis_seek_rate[idx] = settings.homing_seek_rate;
+		settings.homing_axis_pulloff[idx] = settings.homing_pulloff;
+	}
 }
 
 // Method to reset Grbl global settings back to defaults. 
@@ -89,34 +237,41 @@ void settings_reset(bool reset_all)
 		settings.default_feed_rate = DEFAULT_FEEDRATE;
 		settings.default_seek_rate = DEFAULT_RAPID_FEEDRATE;
 		settings.acceleration = DEFAULT_ACCELERATION;
-		settings.mm_per_arc_segment = DEFAULT_MM_PER_ARC_SEGMENT;
 		settings.invert_mask = DEFAULT_STEPPING_INVERT_MASK;
 		settings.junction_deviation = DEFAULT_JUNCTION_DEVIATION;
 	}
 	// New settings since last version
+	settings.arc_tolerance = DEFAULT_ARC_TOLERANCE;
 	settings.flags = 0;
 	if (DEFAULT_REPORT_INCHES) { settings.flags |= BITFLAG_REPORT_INCHES; }
 	if (DEFAULT_AUTO_START) { settings.flags |= BITFLAG_AUTO_START; }
 	if (DEFAULT_INVERT_ST_ENABLE) { settings.flags |= BITFLAG_INVERT_ST_ENABLE; }
 	if (DEFAULT_HARD_LIMIT_ENABLE) { settings.flags |= BITFLAG_HARD_LIMIT_ENABLE; }
 	if (DEFAULT_HOMING_ENABLE) { settings.flags |= BITFLAG_HOMING_ENABLE; }
+	if (DEFAULT_SOFT_LIMIT_ENABLE) { settings.flags |= BITFLAG_SOFT_LIMIT_ENABLE; }
 	settings.homing_dir_mask = DEFAULT_HOMING_DIR_MASK;
 	settings.homing_feed_rate = DEFAULT_HOMING_FEEDRATE;
 	settings.homing_seek_rate = DEFAULT_HOMING_RAPID_FEEDRATE;
-	settings.homing_debounce_delay = DEFAULT_HOMING_DEBOUNCE_DELAY;
+	settings.limit_debounce_time = DEFAULT_LIMIT_DEBOUNCE_TIME;
 	settings.homing_pulloff = DEFAULT_HOMING_PULLOFF;
+	copy_axis_homing_settings();
+	settings.max_travel[X_AXIS] = DEFAULT_X_MAX_TRAVEL;
+	settings.max_travel[Y_AXIS] = DEFAULT_Y_MAX_TRAVEL;
+	settings.max_travel[Z_AXIS] = DEFAULT_Z_MAX_TRAVEL;
 	settings.stepper_idle_lock_time = DEFAULT_STEPPER_IDLE_LOCK_TIME;
 	settings.decimal_places = DEFAULT_DECIMAL_PLACES;
 	settings.n_arc_correction = DEFAULT_N_ARC_CORRECTION;
+	settings.status_report_mask = DEFAULT_STATUS_REPORT_MASK;
+	settings.baud_rate = BAUD_RATE;
 	write_global_settings();
 }
 
 // Reads startup line from EEPROM. Updated pointed line string data.
 uint8_t settings_read_startup_line(uint8_t n, char *line)
 {
-	uint16_t addr = n*(LINE_BUFFER_SIZE+1)+EEPROM_ADDR_STARTUP_BLOCK;
+	uint16_t addr = n*EEPROM_RECORD_SIZE(LINE_BUFFER_SIZE)+EEPROM_ADDR_STARTUP_BLOCK;
 	
-	if (!(memcpy_from_eeprom_with_checksum((char*)line, addr, LINE_BUFFER_SIZE)))
+	if (!(eeprom_read_record((char*)line, addr, STARTUP_LINE_VERSION, LINE_BUFFER_SIZE)))
 	{
 		// Reset line with default value
 		line[0] = 0;
@@ -129,24 +284,86 @@ uint8_t settings_read_startup_line(uint8_t n, char *line)
 	}
 }
 
-// Read selected coordinate data from EEPROM. Updates pointed coord_data value.
+// Read selected coordinate data from the RAM copy. Updates pointed coord_data value. Always
+// succeeds, since the data was validated when loaded at startup.
 // 从EEPROM中读取选择的坐标系坐标值并将坐标值更新至坐标系中
 uint8_t settings_read_coord_data(uint8_t coord_select, float *coord_data)
 {
-	uint16_t addr = coord_select*(sizeof(float)*N_AXIS+1) + EEPROM_ADDR_PARAMETERS;	//计算选取坐标系的首地址
-	if (!(memcpy_from_eeprom_with_checksum((char*)coord_data, addr, sizeof(float)*N_AXIS))) 
+	memcpy(coord_data, coord_table[coord_select], sizeof(float)*N_AXIS);
+	return(true);
+}  
+
+// Selects the active settings profile. The profile is read and validated before anything changes,
+// and only its index is written to EEPROM. The machine position is kept in millimeters across a
+// change of steps/mm, and the values derived from the settings are recomputed once. Requires no
+// motion in progress.
+uint8_t settings_select_profile(uint8_t n)
+{
+	if (n >= N_SETTINGS_PROFILES) { return(STATUS_SETTING_PROFILE); }
+	settings_t profile;
+	if (!(eeprom_read_record((char*)&profile, profile_address(n), SETTINGS_VERSION, sizeof(settings_t))))
 	{
-		// Reset with default zero vector
-		clear_vector_float(coord_data);	// 清除坐标系坐标值
-		settings_write_coord_data(coord_select,coord_data);
-		return(false);
-	} 
-	else 
+		// Not stored yet. Starts out as a copy of the active profile.
+		memcpy(&profile, &settings, sizeof(settings_t));
+		eeprom_write_record(profile_address(n), SETTINGS_VERSION, (char*)&profile, sizeof(settings_t));
+	}
+
+	float position[N_AXIS];
+	uint8_t idx;
+	for (idx=0; idx<N_AXIS; idx++) { position[idx] = sys.position[idx]/settings.steps_per_mm[idx]; }
+	memcpy(&settings, &profile, sizeof(settings_t));
+	settings_profile = n;
+	eeprom_update_char(EEPROM_ADDR_PROFILE, n);
+	for (idx=0; idx<N_AXIS; idx++) { sys.position[idx] = lround(position[idx]*settings.steps_per_mm[idx]); }
+	sys_sync_current_position();
+	limits_init(); // Hard limits, soft limits envelope and debounce samples
+	return(STATUS_OK);
+}
+
+uint8_t settings_get_profile()
+{
+	return(settings_profile);
+}
+
+// Migrates the startup lines of settings versions 5 to 8 to records. The last line goes first,
+// since each new record is larger and overlaps the following old ones.
+static void migrate_startup_lines()
+{
+	char line[LINE_BUFFER_SIZE];
+	uint8_t n = N_STARTUP_LINE;
+	while (n--)
 	{
-		return(true);
+		uint16_t addr = n*(LINE_BUFFER_SIZE+1)+EEPROM_ADDR_STARTUP_BLOCK;
+		if (!(memcpy_from_eeprom_with_checksum(line, addr, LINE_BUFFER_SIZE))) { line[0] = 0; }
+		settings_store_startup_line(n, line);
 	}
+}
+
+// Loads selected coordinate data from its fixed record of earlier versions into the RAM copy and
+// queues it for the journal. Returns false, if the stored data fails its checksum.
+static uint8_t migrate_coord_data(uint8_t coord_select)
+{
+	uint16_t addr = coord_select*(sizeof(float)*N_AXIS+1) + EEPROM_ADDR_PARAMETERS;	//计算选取坐标系的首地址
+	coord_dirty |= bit(coord_select);
+	return(memcpy_from_eeprom_with_checksum((char*)coord_table[coord_select], addr, sizeof(float)*N_AXIS));
 }  
 
+// Sets the global settings appended or changed since the given settings version to their defaults
+// and stores the migrated settings: the per-axis homing settings in version 10, the max travel in
+// version 11, and the limit debounce time replacing the homing debounce delay in version 12.
+static void migrate_appended_settings(uint8_t version)
+{
+	if (version < 10) { copy_axis_homing_settings(); }
+	if (version < 11)
+	{
+		settings.max_travel[X_AXIS] = DEFAULT_X_MAX_TRAVEL;
+		settings.max_travel[Y_AXIS] = DEFAULT_Y_MAX_TRAVEL;
+		settings.max_travel[Z_AXIS] = DEFAULT_Z_MAX_TRAVEL;
+	}
+	settings.limit_debounce_time = DEFAULT_LIMIT_DEBOUNCE_TIME;
+	write_global_settings();
+}
+
 // Reads Grbl global settings struct from EEPROM.
 // 从EEPROM中读取GRBL的全局参数，如读取的为老版本将老版本重置为最新版本，读取成功true，读取失败false
 uint8_t read_global_settings() 
@@ -156,15 +373,45 @@ uint8_t read_global_settings()
 
 	if (version == SETTINGS_VERSION)
 	{
-		// Read settings-record and check checksum
-		if (!(memcpy_from_eeprom_with_checksum((char*)&settings, EEPROM_ADDR_GLOBAL, sizeof(settings_t)))) 
+		// Read settings-record and check header and CRC
+		if (!(eeprom_read_record((char*)&settings, EEPROM_ADDR_GLOBAL, SETTINGS_VERSION, sizeof(settings_t)))) 
 		{
 			return(false);
 		}
 	}
 	else
 	{
-		if (version <= 4) 
+		if (version >= 9 && version <= 11)
+		{
+			// Migrate from settings versions 9 to 11. Same record, except the fields appended since.
+			uint8_t size = sizeof(settings_t);
+			if (version == 10) { size = offsetof(settings_t, max_travel); }
+			else if (version == 9) { size = offsetof(settings_t, homing_axis_feed_rate); }
+			if (!(eeprom_read_record((char*)&settings, EEPROM_ADDR_GLOBAL, version, size))) 
+			{
+				return(false);
+			}
+			migrate_appended_settings(version);
+		}
+		else if (version >= 5 && version <= 8)
+		{
+			// Migrate from settings version 5 to 8, stored with a single checksum byte. Same record
+			// layout, except the fields appended since: the status report mask in version 7 and the
+			// baud rate in version 8. Version 5 also stored the arc setting as mm per segment, which
+			// changed to a chord tolerance.
+			uint16_t size = offsetof(settings_t, homing_axis_feed_rate);
+			if (version == 7) { size = offsetof(settings_t, baud_rate); }
+			else if (version < 7) { size = offsetof(settings_t, status_report_mask); }
+			if (!(memcpy_from_eeprom_with_checksum((char*)&settings, EEPROM_ADDR_GLOBAL, size))) 
+			{
+				return(false);
+			}
+			if (version == 5) { settings.arc_tolerance = DEFAULT_ARC_TOLERANCE; }
+			if (version < 7) { settings.status_report_mask = DEFAULT_STATUS_REPORT_MASK; }
+			if (version < 8) { settings.baud_rate = BAUD_RATE; }
+			migrate_appended_settings(version);
+		}
+		else if (version <= 4) 
 		{
 			// Migrate from settings version 4 to current version.
 			// 读取V4版的参数并将参数重置成最新版本
@@ -201,7 +448,10 @@ uint8_t settings_store_global_setting(int parameter, float value)
 		case 7: settings.stepper_idle_lock_time = round(value); break;
 		case 8: settings.acceleration = value*60*60; break; // Convert to mm/min^2 for grbl internal use.
 		case 9: settings.junction_deviation = fabs(value); break;
-		case 10: settings.mm_per_arc_segment = value; break;
+		case 10:
+			if (value <= 0.0) { return(STATUS_SETTING_VALUE_NEG); }
+			settings.arc_tolerance = value;
+			break;
 		case 11: settings.n_arc_correction = round(value); break;
 		case 12: settings.decimal_places = round(value); break;
 		case 13:
@@ -225,11 +475,56 @@ uint8_t settings_store_global_setting(int parameter, float value)
 			if (value) { settings.flags |= BITFLAG_HOMING_ENABLE; }
 			else { settings.flags &= ~BITFLAG_HOMING_ENABLE; }
 			break;
-		case 18: settings.homing_dir_mask = trunc(value); break;
-		case 19: settings.homing_feed_rate = value; break;
-		case 20: settings.homing_seek_rate = value; break;
-		case 21: settings.homing_debounce_delay = round(value); break;
-		case 22: settings.homing_pulloff = value; break;
+		case 18: 
+			settings.homing_dir_mask = trunc(value); 
+			limits_init(); // Moves the soft limits envelope.
+			break;
+		case 19: case 20: case 22: // Common homing settings. Applied to all axes.
+			if (parameter != 22 && value <= 0.0) { return(STATUS_SETTING_VALUE_NEG); }
+			if (parameter == 19) { settings.homing_feed_rate = value; }
+			else if (parameter == 20) { settings.homing_seek_rate = value; }
+			else { settings.homing_pulloff = value; }
+			copy_axis_homing_settings();
+			break;
+		case 21: 
+			if (value < 0.0) { return(STATUS_SETTING_VALUE_NEG); }
+			if (value > 65535.0) { return(STATUS_INVALID_STATEMENT); } // Does not fit the uint16_t.
+			settings.limit_debounce_time = round(value); 
+			limits_init(); // Recomputes the debounce sample count.
+			break;
+		case 23: settings.status_report_mask = trunc(value); break;
+		case 24: // Applied upon reset, so the response still arrives at the current baud rate.
+			{
+				if (value < 1 || value > F_CPU/8) { return(STATUS_SETTING_BAUD_RATE); }
+				uint32_t baud_rate = lround(value);
+				uint16_t ubrr;
+				if (fabs(serial_baud_error(baud_rate, false, &ubrr)) > SERIAL_BAUD_MAX_ERROR &&
+				    fabs(serial_baud_error(baud_rate, true, &ubrr)) > SERIAL_BAUD_MAX_ERROR) 
+				{ 
+					return(STATUS_SETTING_BAUD_RATE); 
+				}
+				settings.baud_rate = baud_rate;
+			}
+			break;
+		case 25: case 26: case 27:
+			if (value <= 0.0) { return(STATUS_SETTING_VALUE_NEG); }
+			settings.homing_axis_feed_rate[parameter-25] = value;
+			break;
+		case 28: case 29: case 30:
+			if (value <= 0.0) { return(STATUS_SETTING_VALUE_NEG); }
+			settings.homing_axis_seek_rate[parameter-28] = value;
+			break;
+		case 31: case 32: case 33: settings.homing_axis_pulloff[parameter-31] = value; break;
+		case 34:
+			if (value) { settings.flags |= BITFLAG_SOFT_LIMIT_ENABLE; }
+			else { settings.flags &= ~BITFLAG_SOFT_LIMIT_ENABLE; }
+			limits_init(); // Applies to the next motion checked.
+			break;
+		case 35: case 36: case 37:
+			if (value <= 0.0) { return(STATUS_SETTING_VALUE_NEG); }
+			settings.max_travel[parameter-35] = value;
+			limits_init();
+			break;
 		default: return(STATUS_INVALID_STATEMENT);
 	}
 	write_global_settings();
@@ -239,20 +534,54 @@ uint8_t settings_store_global_setting(int parameter, float value)
 // Initialize the config subsystem
 void settings_init() 
 {
+	// Data of settings versions 5 to 8 is checksummed the old way and migrated below.
+	uint8_t version = eeprom_get_char(0);
+	uint8_t legacy = (version >= 5 && version <= 8);
+	if (legacy) { migrate_startup_lines(); }
+
+	// Validate and load all parameter data into the RAM copy once. Coordinate data is not read
+	// from EEPROM again until the next power up. Records of earlier versions not in the journal yet
+	// are migrated from their fixed locations. If missing or error, reset to zero and report. The
+	// G92 offset and the parked position have no fixed record. They start at zero and not parked.
+	// Done before the settings, and the records written to the journal right away, so they are in
+	// EEPROM ahead of the new version byte. A power loss before then boots the earlier version
+	// again, which still migrates from the intact fixed records.
+	journal_scan();
+	if (record_slot[SETTING_INDEX_PARK] == JOURNAL_NO_SLOT) { coord_table[SETTING_INDEX_PARK][X_AXIS] = NAN; }
+	uint8_t i;
+	for (i=0; i<=SETTING_INDEX_NCOORD; i++) //
+	{
+		if (record_slot[i] != JOURNAL_NO_SLOT) { continue; }
+		if (!legacy || !migrate_coord_data(i)) 
+		{
+			clear_vector_float(coord_table[i]);
+			coord_dirty |= bit(i);
+			report_status_message(STATUS_SETTING_READ_FAIL);
+		}
+	}
+	journal_flush();
+
 	if(!read_global_settings()) 
 	{
 		report_status_message(STATUS_SETTING_READ_FAIL);
 		settings_reset(true);
 		report_grbl_settings();
 	}
-	// Read all parameter data into a dummy variable. If error, reset to zero, otherwise do nothing.
-	float coord_data[N_AXIS];
-	uint8_t i;
-	for (i=0; i<=SETTING_INDEX_NCOORD; i++) //
+	// Load the active settings profile in place of profile 0. A profile which does not read, such as
+	// one stored by an earlier settings version, falls back to profile 0.
+	uint8_t n = eeprom_get_char(EEPROM_ADDR_PROFILE);
+	if (n != 0 && n < N_SETTINGS_PROFILES)
 	{
-		if (!settings_read_coord_data(i, coord_data)) 
+		settings_t profile;
+		if (eeprom_read_record((char*)&profile, profile_address(n), SETTINGS_VERSION, sizeof(settings_t)))
+		{
+			memcpy(&settings, &profile, sizeof(settings_t));
+			settings_profile = n;
+		}
+		else
 		{
 			report_status_message(STATUS_SETTING_READ_FAIL);
+			eeprom_update_char(EEPROM_ADDR_PROFILE, 0);
 		}
 	}
 	// NOTE: Startup lines are handled and called by main.c at the end of initialization.
@@ -37,7 +37,7 @@
 
 // Version of the EEPROM data. Will be used to migrate existing data from older versions of Grbl
 // when firmware is upgraded. Always stored in byte 0 of eeprom
-#define SETTINGS_VERSION            5
+#define SETTINGS_VERSION            12
 
 // Define bit flag masks for the boolean settings in settings.flag.
 #define BITFLAG_REPORT_INCHES       bit(0)
@@ -45,24 +45,65 @@
 #define BITFLAG_INVERT_ST_ENABLE    bit(2)
 #define BITFLAG_HARD_LIMIT_ENABLE   bit(3)
 #define BITFLAG_HOMING_ENABLE       bit(4)
+#define BITFLAG_SOFT_LIMIT_ENABLE   bit(5)
+
+// Define bit flag masks for the fields of the real-time status report in settings.status_report_mask
+#define BITFLAG_RT_STATUS_MACHINE_POSITION  bit(0) // MPos
+#define BITFLAG_RT_STATUS_WORK_POSITION     bit(1) // WPos
+#define BITFLAG_RT_STATUS_WORK_OFFSET       bit(2) // WCO, only when changed. Host computes WPos=MPos-WCO.
+#define BITFLAG_RT_STATUS_FEED_RATE         bit(3) // F, current feed rate
+#define BITFLAG_RT_STATUS_BUFFER_STATE      bit(4) // Buf and RX, free planner blocks and RX bytes
+#define BITFLAG_RT_STATUS_LINE_NUMBER       bit(5) // Ln, executing and last parsed N line number
+#define BITFLAG_RT_STATUS_LIMIT_PINS        bit(6) // Lim, triggered limit switches as XYZ
+#define BITFLAG_RT_STATUS_INTEGER_STEPS     bit(7) // Positions in integer steps instead of mm or inches
 
 // Define EEPROM memory address location values for Grbl settings and parameters
-// NOTE: The Atmega328p has 1KB EEPROM. The upper half is reserved for parameters and
-// the startup script. The lower half contains the global settings and space for future 
-// developments.
-// 注意: Atmega328p的EEPROM有1K。高512字节用于参数和启动脚本，低512字节包含全局参数和
-// 备用的扩展区域。
+// NOTE: The Atmega328p has 1KB EEPROM. The global settings record starts at byte 1. All records
+// carry a version and length header and a CRC-16 (see eeprom.c). Byte 0 repeats the settings
+// version, so the checksummed records of versions before 9 are recognized for migration. The coordinate
+// parameters are kept in a wear-leveled journal in the rest of the lower half. The upper half
+// holds the fixed parameter records of earlier versions, read only to migrate records missing
+// from the journal and then reused for the settings profiles, and the startup script.
+// 注意: Atmega328p的EEPROM有1K。低512字节包含全局参数和坐标参数日志，高512字节用于旧版本参数
+// 和启动脚本。
 #define EEPROM_ADDR_GLOBAL          1
-#define EEPROM_ADDR_PARAMETERS      512
+#define EEPROM_ADDR_PROFILE         127 // Active settings profile index, after the global record
+#define EEPROM_ADDR_JOURNAL         128
+#define EEPROM_ADDR_PARAMETERS      512 // Earlier versions. Migrated into the journal.
 #define EEPROM_ADDR_STARTUP_BLOCK   768
 
+// Coordinate parameter journal. Each change is written as a new entry with a sequence number into
+// the next slot not holding the newest copy of any record, so the writes of frequently changed
+// records rotate over all free slots. Entry: record header (2 bytes), sequence number (2), record
+// index (1), data (12), CRC (2).
+#define JOURNAL_SLOT_SIZE           19
+#define JOURNAL_SLOTS               20  // Up to EEPROM_ADDR_PARAMETERS
+
+// Settings profiles. Profile 0 is the global settings record. The others are stored from
+// EEPROM_ADDR_PROFILES on, by default in place of the parameter records of earlier versions, which
+// are no longer read once migrated. A profile not stored yet, or stored by another settings version,
+// starts out as a copy of the active profile when first selected. The Mega 2560 pin map overrides
+// these for its larger EEPROM.
+#ifndef N_SETTINGS_PROFILES
+  #define N_SETTINGS_PROFILES       3
+#endif
+#ifndef EEPROM_ADDR_PROFILES
+  #define EEPROM_ADDR_PROFILES      EEPROM_ADDR_PARAMETERS // Room for 2 profiles before the startup block
+#endif
+
+// Record versions of the journal entries and the startup lines. Unlike the global settings, these
+// only change with their own layout.
+#define JOURNAL_VERSION             1
+#define STARTUP_LINE_VERSION        1
+
 // Define EEPROM address indexing for coordinate parameters
 #define N_COORDINATE_SYSTEM         6                      // Number of supported work coordinate systems (from index 1)
 #define SETTING_INDEX_NCOORD        N_COORDINATE_SYSTEM+1  // Total number of system stored (from index 0)
 // NOTE: Work coordinate indices are (0=G54, 1=G55, ... , 6=G59)
 #define SETTING_INDEX_G28           N_COORDINATE_SYSTEM    // Home position 1
 #define SETTING_INDEX_G30           N_COORDINATE_SYSTEM+1  // Home position 2
-// #define SETTING_INDEX_G92    N_COORDINATE_SYSTEM+2  // Coordinate offset (G92.2,G92.3 not supported)
+#define SETTING_INDEX_G92           N_COORDINATE_SYSTEM+2  // Coordinate offset (G92.2,G92.3 not supported)
+#define SETTING_INDEX_PARK          N_COORDINATE_SYSTEM+3  // Parked machine position. X is NAN, if not parked.
 
 // Global persistent settings (Stored from byte EEPROM_ADDR_GLOBAL onwards)
 // 设置的全局变量(之前已经被存入EEPROM)
@@ -74,16 +115,16 @@ typedef struct {
 	float    default_feed_rate;　　　　　　　 // default feed, mm/min
 	float    default_seek_rate;　　　　　　　 // default seek, mm/min
 	uint8_t  invert_mask;                     // step port invert mask, int:00011100
-	float    mm_per_arc_segment;              // arc, mm/segment
+	float    arc_tolerance;                   // arc tolerance, mm (max chord deviation)
 	float    acceleration;                    // acceleration mm/s^2
 	float    junction_deviation;              // junction deviation, mm
 	uint8_t  flags;                           // Contains default boolean settings
-	                                          // report inches | auto start | invert step enable | hard limits | homing cycle
-	                                          // 标置: 英寸 | 自动启动 | 步进使能 | 硬限位使能 | 回零
+	                                          // report inches | auto start | invert step enable | hard limits | homing cycle | soft limits
+	                                          // 标置: 英寸 | 自动启动 | 步进使能 | 硬限位使能 | 回零 | 软限位
 	uint8_t  homing_dir_mask;                 // homing dir invert mask, int:00000000
 	float    homing_feed_rate;                // homing feed, mm/min
 	float    homing_seek_rate;                // homing seek, mm/min
-	uint16_t homing_debounce_delay;           // homing debounce, msec(防抖动)
+	uint16_t limit_debounce_time;             // limit debounce, usec. Time the limit pins must read the same (防抖动)
 	float    homing_pulloff;                  // homing pull-off, mm
 	uint8_t  stepper_idle_lock_time;          // If max value 255, steppers do not disable. step idle delay, msec
 	                                          // Every time your steppers complete a motion and come to a stop, Grbl will disable
@@ -91,7 +132,12 @@ typedef struct {
 	                                          // keep the steppers locked before disabling
 	uint8_t  decimal_places;                  // n-decimals, int 小数点后有效数字位数
 	uint8_t  n_arc_correction;                // n_arc圆弧拆分误差量
-	//  uint8_t status_report_mask; // Mask to indicate desired report data.
+	uint8_t  status_report_mask;              // Mask to indicate desired report data.
+	uint32_t baud_rate;                       // Applied upon reset. New fields are appended for migration.
+	float    homing_axis_feed_rate[N_AXIS];   // Per-axis homing feed, mm/min. Set all at once by homing feed.
+	float    homing_axis_seek_rate[N_AXIS];   // Per-axis homing seek, mm/min. Set all at once by homing seek.
+	float    homing_axis_pulloff[N_AXIS];     // Per-axis homing pull-off, mm. Set all at once by homing pull-off.
+	float    max_travel[N_AXIS];              // Soft limits travel from machine zero, mm
 } settings_t;
 extern settings_t settings;
 
@@ -107,10 +153,19 @@ void settings_store_startup_line(uint8_t n, char *line);
 // Reads an EEPROM startup line to the protocol line variable
 uint8_t settings_read_startup_line(uint8_t n, char *line);
 
-// Writes selected coordinate data to EEPROM
+// Selects the active settings profile. Loads it and persists only the profile index.
+uint8_t settings_select_profile(uint8_t n);
+
+// Returns the index of the active settings profile
+uint8_t settings_get_profile();
+
+// Writes selected coordinate data. Stored in RAM and written back to EEPROM in the background
 void settings_write_coord_data(uint8_t coord_select, float *coord_data);
 
-// Reads selected coordinate data from EEPROM
+// Reads selected coordinate data from the RAM copy loaded at startup
 uint8_t settings_read_coord_data(uint8_t coord_select, float *coord_data);
 
+// Writes back changed coordinate data to EEPROM, one byte per call without blocking
+void settings_sync_coord_data();
+
 #endif
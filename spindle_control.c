@@ -29,7 +29,6 @@
 
 #include "settings.h"
 #include "spindle_control.h"
-#include "planner.h"
 
 static uint8_t current_direction;
 // 主轴初始化
@@ -49,7 +48,6 @@ void spindle_stop()
 void spindle_run(int8_t direction) //, uint16_t rpm) 
 {
   if (direction != current_direction) {
-    plan_synchronize();
     if (direction) {
       if(direction > 0) {
         SPINDLE_DIRECTION_PORT &= ~(1<<SPINDLE_DIRECTION_BIT);
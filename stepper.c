@@ -33,6 +33,9 @@
 #include "config.h"
 #include "settings.h"
 #include "planner.h"
+#include "spindle_control.h"
+#include "coolant_control.h"
+#include "limits.h"
 
 // Some useful constants
 #define TICKS_PER_MICROSECOND (F_CPU/1000000)
@@ -53,6 +56,12 @@ typedef struct {
 	                                       // pace without allocating a separate timer
 	uint32_t trapezoid_adjusted_rate;      // The current rate of step_events according to the trapezoid generator
 	uint32_t min_safe_rate;                // Minimum safe rate for full deceleration rate reduction step. Otherwise halves step_rate.
+
+	uint16_t line_number;                  // Line number of the executing or last executed block, low 16 bits
+
+	// Used by the homing cycle
+	uint8_t  homing_axes;                  // Axes still moving towards their limit switch state
+	uint8_t  homing_invert;                // Limit pins to invert, so a stopped axis reads low
 } stepper_t;
 
 static stepper_t st;
@@ -101,7 +110,7 @@ void st_wake_up()
 	{ 
 		STEPPERS_DISABLE_PORT &= ~(1<<STEPPERS_DISABLE_BIT);
 	}
-	if (sys.state == STATE_CYCLE) {
+	if (sys.state == STATE_CYCLE || sys.state == STATE_JOG || sys.state == STATE_HOMING) {
 		// Initialize stepper output bits
 		out_bits = (0) ^ (settings.invert_mask); 
 		// Initialize step pulse timing from settings. Here to ensure updating after re-writing.
@@ -128,8 +137,9 @@ void st_go_idle()
 	// 步进电机驱动中断关闭
 	TIMSK1 &= ~(1<<OCIE1A); 
 	// Disable steppers only upon system alarm activated or by user setting to not be kept enabled.
+	// Between the homing motions, they stay enabled to hold the located position.
 	// 当报警或是用户半闭步进电机时步进电机停止运动
-	if ((settings.stepper_idle_lock_time != 0xff) || bit_istrue(sys.execute,EXEC_ALARM)) 
+	if ((settings.stepper_idle_lock_time != 0xff && sys.state != STATE_HOMING) || bit_istrue(sys.execute,EXEC_ALARM)) 
 	{
 		// Force stepper dwell to lock axes for a defined amount of time to ensure the axes come to a complete
 		// stop and not drift from residual inertial forces at the end of the last movement.
@@ -189,6 +199,26 @@ ISR(TIMER1_COMPA_vect)
 	// step interrupt compare and will always finish before returning to the main program.
 	sei();
 
+	// During homing, each axis stops as soon as its debounced limit switch is reached, or released
+	// when leaving it. The motion ends once all axes have stopped, usually well before its full travel.
+	uint8_t step_axes = 0xff; // Axes allowed to step
+	if (sys.state == STATE_HOMING)
+	{
+		uint8_t limit_state = limits_get_state() ^ st.homing_invert;
+		if (bit_isfalse(limit_state,bit(X_LIMIT_BIT))) { st.homing_axes &= ~bit(X_AXIS); }
+		if (bit_isfalse(limit_state,bit(Y_LIMIT_BIT))) { st.homing_axes &= ~bit(Y_AXIS); }
+		if (bit_isfalse(limit_state,bit(Z_LIMIT_BIT))) { st.homing_axes &= ~bit(Z_AXIS); }
+		#ifdef GANTRY_SLAVE_AXIS
+			if (bit_isfalse(limit_state,bit(SLAVE_LIMIT_BIT))) { st.homing_axes &= ~SLAVE_AXIS_MASK; }
+		#endif
+		if (!st.homing_axes && current_block != NULL)
+		{
+			current_block = NULL;
+			plan_discard_current_block();
+		}
+		step_axes = st.homing_axes;
+	}
+
 	// If there is no current block, attempt to pop one from the buffer
 	if (current_block == NULL)
 	{
@@ -196,7 +226,8 @@ ISR(TIMER1_COMPA_vect)
 		current_block = plan_get_current_block();
 		if (current_block != NULL)
 		{
-		  	if (sys.state == STATE_CYCLE)
+			st.line_number = current_block->line_number;
+		  	if (sys.state == STATE_CYCLE || sys.state == STATE_JOG || sys.state == STATE_HOMING)
 			{
 				// During feed hold, do not update rate and trap counter. Keep decelerating.
 				st.trapezoid_adjusted_rate = current_block->initial_rate;
@@ -209,9 +240,13 @@ ISR(TIMER1_COMPA_vect)
 			st.counter_z = st.counter_x;
 			st.event_count = current_block->step_event_count;
 			st.step_events_completed = 0;     
+			// Apply spindle and coolant state programmed ahead of this block
+			spindle_run(current_block->spindle_direction);
+			coolant_run(current_block->coolant_mode);
 		}
 		else
 		{
+			plan_apply_accessory_state(); // Apply any state programmed after the last block
 			st_go_idle();
 			bit_true(sys.execute,EXEC_CYCLE_STOP); // Flag main program for cycle end
 		}    
@@ -224,26 +259,47 @@ ISR(TIMER1_COMPA_vect)
 		st.counter_x += current_block->steps_x;
 		if (st.counter_x > 0)
 		{
-			out_bits |= (1<<X_STEP_BIT);
 			st.counter_x -= st.event_count;
-			if (out_bits & (1<<X_DIRECTION_BIT)) { sys.position[X_AXIS]--; }
-			else { sys.position[X_AXIS]++; }
+			#ifdef GANTRY_SLAVE_AXIS
+				// The slaved motor steps with its axis, unless stopped on its own switch when homing.
+				if (GANTRY_SLAVE_AXIS == X_AXIS && (step_axes & SLAVE_AXIS_MASK)) { out_bits |= (1<<SLAVE_STEP_BIT); }
+			#endif
+			if (step_axes & bit(X_AXIS))
+			{
+				out_bits |= (1<<X_STEP_BIT);
+				if (out_bits & (1<<X_DIRECTION_BIT)) { sys.position[X_AXIS]--; }
+				else { sys.position[X_AXIS]++; }
+			}
 		}
 		st.counter_y += current_block->steps_y;
 		if (st.counter_y > 0)
 		{
-			out_bits |= (1<<Y_STEP_BIT);
 			st.counter_y -= st.event_count;
-			if (out_bits & (1<<Y_DIRECTION_BIT)) { sys.position[Y_AXIS]--; }
-			else { sys.position[Y_AXIS]++; }
+			#ifdef GANTRY_SLAVE_AXIS
+				// The slaved motor steps with its axis, unless stopped on its own switch when homing.
+				if (GANTRY_SLAVE_AXIS == Y_AXIS && (step_axes & SLAVE_AXIS_MASK)) { out_bits |= (1<<SLAVE_STEP_BIT); }
+			#endif
+			if (step_axes & bit(Y_AXIS))
+			{
+				out_bits |= (1<<Y_STEP_BIT);
+				if (out_bits & (1<<Y_DIRECTION_BIT)) { sys.position[Y_AXIS]--; }
+				else { sys.position[Y_AXIS]++; }
+			}
 		}
 		st.counter_z += current_block->steps_z;
 		if (st.counter_z > 0)
 		{
-			out_bits |= (1<<Z_STEP_BIT);
 			st.counter_z -= st.event_count;
-			if (out_bits & (1<<Z_DIRECTION_BIT)) { sys.position[Z_AXIS]--; }
-			else { sys.position[Z_AXIS]++; }
+			#ifdef GANTRY_SLAVE_AXIS
+				// The slaved motor steps with its axis, unless stopped on its own switch when homing.
+				if (GANTRY_SLAVE_AXIS == Z_AXIS && (step_axes & SLAVE_AXIS_MASK)) { out_bits |= (1<<SLAVE_STEP_BIT); }
+			#endif
+			if (step_axes & bit(Z_AXIS))
+			{
+				out_bits |= (1<<Z_STEP_BIT);
+				if (out_bits & (1<<Z_DIRECTION_BIT)) { sys.position[Z_AXIS]--; }
+				else { sys.position[Z_AXIS]++; }
+			}
 		}
 
 		st.step_events_completed++; // Iterate step events
@@ -503,12 +559,14 @@ void st_cycle_start()
 {
 	if (sys.state == STATE_QUEUED) 
 	{
+		limits_unpark();
 		sys.state = STATE_CYCLE;
 		st_wake_up();
 	}
 }
 
-// Execute a feed hold with deceleration, only during cycle. Called by main program.
+// Execute a feed hold with deceleration, only during cycle or jog. Called by main program.
+// A feed hold during a jog cancels the jog. The remaining jog motions are discarded once stopped.
 void st_feed_hold() 
 {
 	if (sys.state == STATE_CYCLE) 
@@ -516,6 +574,54 @@ void st_feed_hold()
 		sys.state = STATE_HOLD;
 		sys.auto_start = false; // Disable planner auto start upon feed hold.
 	}
+	else if (sys.state == STATE_JOG)
+	{
+		sys.state = STATE_HOLD;
+		sys.jog_cancel = true;
+	}
+}
+
+// Returns the current feed rate in mm/min, scaled from the nominal speed of the executing block by
+// its current step rate. Zero when not moving or while in a dwell.
+float st_get_realtime_rate()
+{
+	if (sys.state != STATE_CYCLE && sys.state != STATE_HOLD && sys.state != STATE_JOG) { return(0.0); }
+	uint8_t sreg = SREG;
+	cli(); // Pointer and rate are updated by the stepper interrupt.
+	block_t *block = current_block;
+	uint32_t rate = st.trapezoid_adjusted_rate;
+	SREG = sreg;
+	if (block == NULL || block->dwell_flag) { return(0.0); }
+	return(block->nominal_speed*rate/block->nominal_rate);
+}
+
+// Sets the axes a homing motion moves and the limit pin state each one stops at. An axis stops
+// when its pin, after inverting by limit_invert, reads low. Set before buffering the motion. The
+// slaved gantry motor moves only with SLAVE_AXIS_MASK set, and stops on its own pin.
+void st_set_homing_axes(uint8_t axis_mask, uint8_t limit_invert)
+{
+	uint8_t sreg = SREG;
+	cli();
+	st.homing_axes = axis_mask;
+	st.homing_invert = limit_invert;
+	SREG = sreg;
+}
+
+// Returns the axes of the last homing motion, which have not reached their limit pin state.
+uint8_t st_get_homing_axes()
+{
+	return(st.homing_axes);
+}
+
+// Returns the low 16 bits of the line number of the block being executed, or of the last executed
+// block when idle.
+uint16_t st_get_line_number()
+{
+	uint8_t sreg = SREG;
+	cli(); // Updated by the stepper interrupt.
+	uint16_t line_number = st.line_number;
+	SREG = sreg;
+	return(line_number);
 }
 
 // Reinitializes the cycle plan and stepper system after a feed hold for a resume. Called by 
@@ -525,7 +631,18 @@ void st_feed_hold()
 // Only the planner de/ac-celerations profiles and stepper rates have been updated.
 void st_cycle_reinitialize()
 {
-	if (current_block != NULL) 
+	if (sys.state == STATE_HOMING) { return; } // Homing motion complete. The homing cycle continues.
+	if (sys.jog_cancel)
+	{
+		// Jog cancel stop. Discard the partial block and all remaining jog motions, then continue
+		// from where the machine stopped. No steps were lost, so there is no alarm.
+		current_block = NULL;
+		plan_reset_buffer();
+		sys_sync_current_position();
+		sys.jog_cancel = false;
+		sys.state = STATE_IDLE;
+	}
+	else if (current_block != NULL) 
 	{
 		// Replan buffer from the feed hold stop location.
 		plan_cycle_reinitialize(current_block->step_event_count - st.step_events_completed);
@@ -536,6 +653,10 @@ void st_cycle_reinitialize()
 		st.step_events_completed = 0;
 		sys.state = STATE_QUEUED;
 	} 
+	else if (sys.state == STATE_JOG && plan_get_current_block() != NULL)
+	{
+		st_wake_up(); // A jog planned just as the previous one completed. Keep jogging.
+	}
 	else 
 	{
 		sys.state = STATE_IDLE;
@@ -32,6 +32,10 @@
 
 #include <avr/io.h>
 
+// Homing axis mask bit of the slaved motor of a dual-motor gantry axis (GANTRY_SLAVE_AXIS). It
+// homes along with its axis, but stops on its own limit switch.
+#define SLAVE_AXIS_MASK bit(N_AXIS)
+
 // Initialize and setup the stepper motor subsystem
 void st_init();
 
@@ -53,4 +57,16 @@ void st_cycle_reinitialize();
 // Initiates a feed hold of the running program
 void st_feed_hold();
 
+// Returns the current feed rate in mm/min for the real-time status report
+float st_get_realtime_rate();
+
+// Returns the low 16 bits of the line number of the executing block for the real-time status report
+uint16_t st_get_line_number();
+
+// Sets the axes of the next homing motion and the limit pin state they stop at
+void st_set_homing_axes(uint8_t axis_mask, uint8_t limit_invert);
+
+// Returns the axes of the last homing motion, which did not reach their limit pin state
+uint8_t st_get_homing_axes();
+
 #endif